@@ -0,0 +1,238 @@
+/* Standard headers */
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "account_cache.h"
+#include "app_paths.h"
+
+/* File layout */
+
+namespace {
+
+// Bump CACHE_VERSION whenever the layout changes, old files are then ignored
+constexpr char CACHE_MAGIC[4] = {'T', 'T', 'A', 'C'};
+constexpr uint32_t CACHE_VERSION = 2;
+constexpr uint32_t CACHE_FLAG_SIGNED_IN = 1U;
+
+/**
+ * Start of the file. Followed by trackCount CacheTrack entries, then the string blob
+ * (username, stamp, then the track names). Native byte order, the file never leaves the machine
+ */
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t userid;
+    uint64_t checksum;      // HashFNV1a of everything after the header
+    uint64_t seq;
+    uint32_t flags;
+    uint32_t usernameLength;
+    uint32_t stampLength;
+    uint32_t trackCount;
+};
+
+struct CacheTrack {
+    uint64_t seconds;
+    int64_t syncedAt;       // seconds since the epoch
+    uint32_t nameOffset;    // into the string blob
+    uint32_t nameLength;
+};
+
+static_assert(sizeof(CacheHeader) == 48 && sizeof(CacheTrack) == 24, "cache layout must not depend on padding");
+
+/**
+ * Read-only memory mapping of a whole file
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#endif
+};
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path) {
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(m_file == INVALID_HANDLE_VALUE) return;
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) return;
+
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(m_mapping == nullptr) return;
+
+    m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if(m_data != nullptr) m_size = static_cast<size_t>(size.QuadPart);
+}
+
+MappedFile::~MappedFile() {
+    if(m_data != nullptr) UnmapViewOfFile(m_data);
+    if(m_mapping != nullptr) CloseHandle(m_mapping);
+    if(m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+}
+#else
+MappedFile::MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return;
+
+    struct stat info{};
+    if(fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data != MAP_FAILED) {
+            m_data = static_cast<const char*>(data);
+            m_size = static_cast<size_t>(info.st_size);
+        }
+    }
+    close(fd); // the mapping keeps the file alive
+}
+
+MappedFile::~MappedFile() {
+    if(m_data != nullptr) munmap(const_cast<char*>(m_data), m_size);
+}
+#endif
+
+} // namespace
+
+/* Method definitions */
+
+uint64_t HashFNV1a(std::string_view data, uint64_t hash) {
+    for(unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::string AccountCachePath() {
+    return AppFilePath("account.cache", AppDir::Cache);
+}
+
+bool LoadAccountCache(const std::string& path, CachedAccount& account, TrackTable& tracks) {
+    MappedFile file(path);
+    if(file.data() == nullptr || file.size() < sizeof(CacheHeader)) return false;
+
+    CacheHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if(memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION) return false;
+
+    // Everything is bounds checked in 64 bits before it is touched
+    const uint64_t tableSize = static_cast<uint64_t>(header.trackCount) * sizeof(CacheTrack);
+    if(tableSize > file.size() - sizeof(CacheHeader)) return false;
+    const char* table = file.data() + sizeof(CacheHeader);
+    const char* blob = table + tableSize;
+    const uint64_t blobSize = file.size() - sizeof(CacheHeader) - tableSize;
+    if(static_cast<uint64_t>(header.usernameLength) + header.stampLength > blobSize) return false;
+
+    if(HashFNV1a(std::string_view(table, file.size() - sizeof(CacheHeader))) != header.checksum) return false;
+
+    account.userid = header.userid;
+    account.username.assign(blob, header.usernameLength);
+    account.stamp.assign(blob + header.usernameLength, header.stampLength);
+    account.seq = header.seq;
+    account.signedIn = (header.flags & CACHE_FLAG_SIGNED_IN) != 0;
+
+    tracks.clear();
+    for(uint32_t i = 0; i < header.trackCount; i++) {
+        CacheTrack track;
+        memcpy(&track, table + static_cast<size_t>(i) * sizeof(CacheTrack), sizeof(track));
+        if(static_cast<uint64_t>(track.nameOffset) + track.nameLength > blobSize) {
+            tracks.clear();
+            return false;
+        }
+
+        std::chrono::time_point<std::chrono::system_clock> syncedAt{std::chrono::seconds(track.syncedAt)};
+        tracks.insert(std::string(blob + track.nameOffset, track.nameLength), track.seconds, syncedAt);
+    }
+
+    return true;
+}
+
+void EncodeAccountCache(const CachedAccount& account, const TrackTable& tracks, std::string& image) {
+    std::vector<uint32_t> ids;
+    tracks.index().search("", ids); // every live track, in server order
+
+    CacheHeader header{};
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.userid = account.userid;
+    header.seq = account.seq;
+    header.flags = account.signedIn ? CACHE_FLAG_SIGNED_IN : 0U;
+    header.usernameLength = static_cast<uint32_t>(account.username.size());
+    header.stampLength = static_cast<uint32_t>(account.stamp.size());
+    header.trackCount = static_cast<uint32_t>(ids.size());
+
+    // Header and track table up front, the names go into the blob behind them
+    const size_t tableEnd = sizeof(CacheHeader) + ids.size() * sizeof(CacheTrack);
+    image.assign(tableEnd, '\0');
+    memcpy(image.data(), &header, sizeof(header));
+    image += account.username;
+    image += account.stamp;
+
+    for(size_t i = 0; i < ids.size(); i++) {
+        const TrackRecord& track = tracks[ids[i]];
+        CacheTrack entry {
+            track.seconds,
+            std::chrono::duration_cast<std::chrono::seconds>(track.syncedAt.time_since_epoch()).count(),
+            static_cast<uint32_t>(image.size() - tableEnd),
+            static_cast<uint32_t>(track.name.size())
+        };
+        memcpy(image.data() + sizeof(CacheHeader) + i * sizeof(CacheTrack), &entry, sizeof(entry));
+        image += track.name;
+    }
+}
+
+bool WriteAccountCache(const std::string& path, std::string& image) {
+    if(path.empty() || image.size() < sizeof(CacheHeader)) return false;
+
+    const uint64_t checksum = HashFNV1a(std::string_view(image).substr(sizeof(CacheHeader)));
+    memcpy(image.data() + offsetof(CacheHeader, checksum), &checksum, sizeof(checksum));
+
+    std::error_code error;
+    std::filesystem::path target(path);
+    std::filesystem::create_directories(target.parent_path(), error);
+
+    std::filesystem::path temporary = target;
+    temporary += ".tmp";
+    std::FILE* file = std::fopen(temporary.string().c_str(), "wb");
+    if(file == nullptr) return false;
+    bool written = std::fwrite(image.data(), 1, image.size(), file) == image.size() && std::fflush(file) == 0;
+    // On the disk before the rename, or a crash could leave the new name on an empty file
+#ifdef _WIN32
+    written = written && _commit(_fileno(file)) == 0;
+#else
+    written = written && fsync(fileno(file)) == 0;
+#endif
+    std::fclose(file);
+    if(!written) return false;
+
+    std::filesystem::rename(temporary, target, error);
+    return !error;
+}
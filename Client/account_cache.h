@@ -0,0 +1,67 @@
+#pragma once
+
+/* Standard headers */
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "tracks.h"
+
+/* On-disk account cache */
+
+/**
+ * The account the cache belongs to
+ */
+struct CachedAccount {
+    uint64_t userid{};
+    std::string username{};
+    std::string stamp{};    // server version of the track list it was taken from
+    uint64_t seq{};         // change feed position of the track list, 0 if unknown
+    bool signedIn{};        // restore the session on the next start
+};
+
+constexpr uint64_t FNV1A_OFFSET = 14695981039346656037ULL;
+
+/**
+ * 64-bit FNV-1a hash
+ * @param data Bytes to hash
+ * @param hash Hash of the bytes before data, to hash in pieces
+ * @return Hash value
+ */
+uint64_t HashFNV1a(std::string_view data, uint64_t hash = FNV1A_OFFSET);
+
+/**
+ * Where the cache lives: $XDG_CACHE_HOME (or ~/.cache) /timetracker/account.cache,
+ * %LOCALAPPDATA%\TimeTracker\account.cache on Windows
+ * @return Cache file path, empty if no suitable directory exists
+ */
+std::string AccountCachePath();
+
+/**
+ * Load the last saved account snapshot
+ * The file is memory-mapped and validated (magic, version, bounds, checksum) before use.
+ * @param path Cache file path
+ * @param account Receives the account
+ * @param tracks Receives the tracks (cleared first)
+ * @return Boolean for whether a valid snapshot was loaded
+ */
+bool LoadAccountCache(const std::string& path, CachedAccount& account, TrackTable& tracks);
+
+/**
+ * Encode an account snapshot as a cache file image (cheap, no I/O)
+ * The checksum is left to WriteAccountCache(), so the pass over every byte happens where the write does.
+ * @param account The account
+ * @param tracks Its tracks
+ * @param image Receives the image, its memory is reused
+ */
+void EncodeAccountCache(const CachedAccount& account, const TrackTable& tracks, std::string& image);
+
+/**
+ * Write an image from EncodeAccountCache()
+ * Written and flushed to the disk under a temporary name, then renamed over the old file, so a crash
+ * leaves either the old cache or the new one.
+ * @param path Cache file path
+ * @param image The image, its checksum is filled in
+ * @return Boolean for whether the image was written
+ */
+bool WriteAccountCache(const std::string& path, std::string& image);
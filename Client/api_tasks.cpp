@@ -0,0 +1,100 @@
+/* Standard headers */
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+#include "api_tasks.h"
+
+/* Method definitions */
+
+void APITask::promise_type::unhandled_exception() {
+    try {
+        throw;
+    } catch(const std::exception& e) {
+        fprintf(stderr, "API task failed: %s\n", e.what());
+    } catch(...) {
+        fprintf(stderr, "API task failed\n");
+    }
+}
+
+APITask::APITask(APITask&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+
+APITask::~APITask() {
+    if(m_handle) m_handle.destroy(); // never spawned
+}
+
+APIFuture::APIFuture(APIFuture&& other) noexcept : m_scope(other.m_scope), m_id(std::exchange(other.m_id, 0U)) {}
+
+APIFuture::~APIFuture() {
+    if(m_id != 0U) m_scope->m_calls.erase(m_id);
+}
+
+bool APIFuture::await_ready() const noexcept {
+    auto it = m_scope->m_calls.find(m_id);
+    return it == m_scope->m_calls.end() || it->second.response.has_value();
+}
+
+void APIFuture::await_suspend(std::coroutine_handle<> waiter) {
+    m_scope->m_calls[m_id].waiter = waiter;
+}
+
+APIResponse APIFuture::await_resume() {
+    auto it = m_scope->m_calls.find(m_id);
+    m_id = 0U;
+    if(it == m_scope->m_calls.end() || !it->second.response) return APIResponse {0U, false, "Request was dropped."};
+
+    APIResponse response = std::move(*it->second.response);
+    m_scope->m_calls.erase(it);
+    return response;
+}
+
+APIScope::~APIScope() {
+    cancel();
+}
+
+APIFuture APIScope::await(uint64_t id) {
+    m_calls.emplace(id, Call{});
+    return APIFuture(this, id);
+}
+
+void APIScope::spawn(APITask task) {
+    auto handle = std::exchange(task.m_handle, nullptr);
+    m_tasks.push_back(handle);
+    handle.resume();
+    reap();
+}
+
+bool APIScope::deliver(APIResponse& response) {
+    auto it = m_calls.find(response.id);
+    if(it == m_calls.end() || response.partial) return false;
+
+    it->second.response = std::move(response);
+    if(auto waiter = std::exchange(it->second.waiter, nullptr)) {
+        waiter.resume(); // may start further calls and tasks, it is not in the middle of anything here
+        reap();
+    }
+    return true;
+}
+
+std::vector<uint64_t> APIScope::cancel() {
+    std::vector<uint64_t> ids;
+    ids.reserve(m_calls.size());
+    for(const auto& [id, call] : m_calls) ids.push_back(id);
+
+    // Destroying a frame runs the destructors of its locals, including the futures it holds
+    auto tasks = std::move(m_tasks);
+    m_tasks.clear();
+    for(auto handle : tasks) handle.destroy();
+    m_calls.clear();
+    return ids;
+}
+
+void APIScope::reap() {
+    m_tasks.erase(std::remove_if(m_tasks.begin(), m_tasks.end(), [](auto handle) {
+        if(!handle.done()) return false;
+        handle.destroy();
+        return true;
+    }), m_tasks.end());
+}
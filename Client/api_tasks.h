@@ -0,0 +1,129 @@
+#pragma once
+
+/* Standard headers */
+#include <coroutine>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "network.h"
+
+/* Coroutine API layer */
+
+class APIScope;
+
+/**
+ * Coroutine running a flow of API calls, e.g. register, then log in, then fetch the tracks
+ * Started by APIScope::spawn() and owned by that scope. It runs on the render thread between
+ * co_awaits, so it can touch application state freely; the network worker does the waiting.
+ */
+class APITask {
+public:
+    struct promise_type {
+        APITask get_return_object() { return APITask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }   // spawn() starts it
+        std::suspend_always final_suspend() noexcept { return {}; }     // the scope frees it
+        void return_void() {}
+        void unhandled_exception();
+    };
+
+    APITask(APITask&& other) noexcept;
+    APITask& operator=(APITask&&) = delete;
+    ~APITask();
+
+private:
+    friend class APIScope;
+
+    explicit APITask(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+/**
+ * A request in flight, co_await it for the response
+ * The request was sent when this was made, so calls started one after another run concurrently
+ * and co_await only waits for the answer. Dropping it without awaiting is fine.
+ */
+class APIFuture {
+public:
+    APIFuture(APIFuture&& other) noexcept;
+    APIFuture& operator=(APIFuture&&) = delete;
+    ~APIFuture();
+
+    /**
+     * @return Request id
+     */
+    uint64_t id() const { return m_id; }
+
+    bool await_ready() const noexcept;
+    void await_suspend(std::coroutine_handle<> waiter);
+    APIResponse await_resume();
+
+private:
+    friend class APIScope;
+
+    APIFuture(APIScope* scope, uint64_t id) : m_scope(scope), m_id(id) {}
+
+    APIScope* m_scope;
+    uint64_t m_id;
+};
+
+/**
+ * Owns the API tasks of a session and hands them their responses (render loop only)
+ */
+class APIScope {
+public:
+    APIScope() = default;
+    ~APIScope();
+
+    APIScope(const APIScope&) = delete;
+    APIScope& operator=(const APIScope&) = delete;
+
+    /**
+     * Let a task wait for a request that was sent
+     * @param id Request id from MakeAPICall() and friends
+     * @return Awaitable for the response
+     */
+    APIFuture await(uint64_t id);
+
+    /**
+     * Start a task, it runs until its first co_await right away
+     * @param task The task
+     */
+    void spawn(APITask task);
+
+    /**
+     * Resume the task waiting for a response, if any
+     * @param response A response from PollAPI(), already applied to the application state
+     * @return Boolean for whether a task was waiting for it (then it was moved from)
+     */
+    bool deliver(APIResponse& response);
+
+    /**
+     * Destroy every unfinished task, e.g. on logout. Must not be called from inside a task
+     * @return Ids of the requests they were waiting for, their responses are stale
+     */
+    std::vector<uint64_t> cancel();
+
+    /**
+     * @return Boolean for whether a task is still running
+     */
+    bool busy() const { return !m_tasks.empty(); }
+
+private:
+    friend class APIFuture;
+
+    struct Call {
+        std::optional<APIResponse> response{};  // arrived before anyone awaited it
+        std::coroutine_handle<> waiter{};
+    };
+
+    std::unordered_map<uint64_t, Call> m_calls;
+    std::vector<std::coroutine_handle<APITask::promise_type>> m_tasks;
+
+    /**
+     * Free the tasks that ran to completion
+     */
+    void reap();
+};
@@ -0,0 +1,25 @@
+/* Standard headers */
+#include <cstdlib>
+#include <filesystem>
+
+#include "app_paths.h"
+
+/* Method definitions */
+
+std::string AppFilePath(std::string_view file, AppDir kind) {
+    std::filesystem::path dir;
+#ifdef _WIN32
+    (void)kind;
+    if(const char* local = std::getenv("LOCALAPPDATA"); local != nullptr && *local != '\0')
+        dir = std::filesystem::path(local) / "TimeTracker";
+#else
+    const char* xdg = std::getenv(kind == AppDir::Data ? "XDG_DATA_HOME" : "XDG_CACHE_HOME");
+    if(xdg != nullptr && *xdg != '\0')
+        dir = std::filesystem::path(xdg) / "timetracker";
+    else if(const char* home = std::getenv("HOME"); home != nullptr && *home != '\0')
+        dir = kind == AppDir::Data ? std::filesystem::path(home) / ".local" / "share" / "timetracker"
+                                   : std::filesystem::path(home) / ".cache" / "timetracker";
+#endif
+    if(dir.empty()) return std::string();
+    return (dir / file).string();
+}
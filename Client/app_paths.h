@@ -0,0 +1,23 @@
+#pragma once
+
+/* Standard headers */
+#include <string>
+#include <string_view>
+
+/* Per-user application files */
+
+/**
+ * Kind of directory a file belongs in
+ */
+enum class AppDir {
+    Cache,  // can be rebuilt: $XDG_CACHE_HOME (or ~/.cache) /timetracker
+    Data    // must survive cache cleanups: $XDG_DATA_HOME (or ~/.local/share) /timetracker
+};
+
+/**
+ * Where an application file lives, %LOCALAPPDATA%\TimeTracker\ on Windows for either kind
+ * @param file File name
+ * @param kind Kind of directory
+ * @return File path, empty if no suitable directory exists
+ */
+std::string AppFilePath(std::string_view file, AppDir kind);
@@ -0,0 +1,188 @@
+/* Standard headers */
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Third Party headers */
+#include <benchmark/benchmark.h>
+
+#include "../journal.h"
+#include "../network.h"
+#include "../responses.h"
+#include "../snapshots.h"
+#include "../tracks.h"
+
+/* Sample bodies, shaped like the server's */
+
+/**
+ * One body of each kind, labelled by its behavior (none for plain message / error responses)
+ */
+static const std::vector<std::pair<const char*, std::string>>& BehaviorBodies() {
+    static const std::vector<std::pair<const char*, std::string>> bodies = {
+        {"message", R"({"message":"Added track!"})"},
+        {"error", R"({"error":"Track not found."})"},
+        {"VERSION", R"({"behavior":"VERSION","name":"TimeTracker","description":"Tracks time spent on projects","version":"1.4.2"})"},
+        {"AUTHENTICATION", R"({"behavior":"AUTHENTICATION","username":"benchmark","uid":1})"},
+        {"CHANGES", R"({"behavior":"CHANGES","seq":412,"etag":"W/\"1-412\"","changes":[{"seq":411,"kind":"seconds","track":"Project 12 - task 3","seconds":18294},{"seq":412,"kind":"rename","track":"Project 4","name":"Project 4b","seconds":60}]})"},
+        {"SAVEACK", R"({"behavior":"SAVEACK","message":"Saved!"})"},
+        {"SESSIONACK", R"({"behavior":"SESSIONACK","message":"Saved!","ids":["9f2c4e0a1b3d5f71","0c1d2e3f40516273"],"failed":[],"tracks":[{"track":"Project 12 - task 3","seconds":18294}]})"},
+        {"TRACKINFO", R"({"behavior":"TRACKINFO","track":"Project 12 - task 3","seconds":18234})"}
+    };
+    return bodies;
+}
+
+static std::string AccountBody(size_t tracks) {
+    std::string body = R"({"behavior":"ACCOUNT","tracks":[)";
+    for(size_t i = 0; i < tracks; i++) {
+        if(i > 0) body += ',';
+        body += R"({"track":"Project )" + std::to_string(i % 97) + " - task " + std::to_string(i) +
+                R"(","seconds":)" + std::to_string((i * 7919) % 360000) + "}";
+    }
+    body += R"(],"userId":1,"username":"benchmark","seq":)" + std::to_string(tracks) + "}";
+    return body;
+}
+
+static std::vector<JournalEntry> SampleEntries(size_t count) {
+    std::vector<JournalEntry> entries(count);
+    for(size_t i = 0; i < count; i++) {
+        entries[i].id = 0x9f2c4e0a1b3d5f71ULL + i;
+        entries[i].track = "Project " + std::to_string(i % 7) + " & co / task #" + std::to_string(i);
+        entries[i].start = 1760000000 + static_cast<int64_t>(i) * 3600;
+        entries[i].end = entries[i].start + 1800;
+    }
+    return entries;
+}
+
+/* Response decoding, one benchmark per behavior */
+
+static void BM_DecodeBehavior(benchmark::State& state) {
+    const auto& [name, body] = BehaviorBodies()[state.range(0)];
+    ResponseDecoder decoder;
+    decoder.decode(body); // warm the buffers
+    for(auto _ : state) {
+        bool valid = decoder.decode(body);
+        benchmark::DoNotOptimize(valid);
+        benchmark::DoNotOptimize(decoder.response());
+    }
+    state.SetLabel(name);
+    state.SetBytesProcessed(state.iterations() * body.size());
+}
+BENCHMARK(BM_DecodeBehavior)->DenseRange(0, 7);
+
+static void BM_DecodeAccount(benchmark::State& state) {
+    std::string body = AccountBody(state.range(0));
+    ResponseDecoder decoder;
+    for(auto _ : state) {
+        bool valid = decoder.decode(body);
+        benchmark::DoNotOptimize(valid);
+    }
+    state.SetBytesProcessed(state.iterations() * body.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DecodeAccount)->RangeMultiplier(10)->Range(10, 100000);
+
+/* URL / form encoding */
+
+static void BM_URLEncode(benchmark::State& state) {
+    const std::string value = "Project 12 & co / task #3 (draft)";
+    for(auto _ : state) {
+        std::string encoded = URLEncode(value);
+        benchmark::DoNotOptimize(encoded);
+    }
+    state.SetBytesProcessed(state.iterations() * value.size());
+}
+BENCHMARK(BM_URLEncode);
+
+static void BM_TrackForm(benchmark::State& state) {
+    for(auto _ : state) {
+        std::string form;
+        AppendFormField(form, "track", "Project 12 & co / task #3 (draft)");
+        AppendFormField(form, "uid", "1");
+        benchmark::DoNotOptimize(form);
+    }
+}
+BENCHMARK(BM_TrackForm);
+
+static void BM_SessionsForm(benchmark::State& state) {
+    std::vector<JournalEntry> entries = SampleEntries(state.range(0));
+    std::string form;
+    for(auto _ : state) {
+        EncodeSessionsForm(1, entries, form);
+        benchmark::DoNotOptimize(form);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SessionsForm)->Arg(1)->Arg(16)->Arg(64);
+
+/* Track list rebuild from /account payloads */
+
+/**
+ * The snapshot worker's loop, on a decoded response
+ */
+static void BM_BuildTracks(benchmark::State& state) {
+    ResponseDecoder decoder;
+    decoder.decode(AccountBody(state.range(0)));
+    const Response& account = decoder.response();
+    auto now = std::chrono::system_clock::now();
+    for(auto _ : state) {
+        TrackTable tracks;
+        for(const TrackEntry& track : account.tracks) tracks.insert(track.name, track.seconds, now);
+        benchmark::DoNotOptimize(tracks.size());
+        state.PauseTiming(); // freeing happens on the worker as well, but not here
+        tracks.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BuildTracks)->RangeMultiplier(10)->Range(10, 100000)->Unit(benchmark::kMicrosecond);
+
+/**
+ * Body to a swappable table: decode, hand off to the snapshot worker, wait for the snapshot
+ */
+static void BM_AccountToSnapshot(benchmark::State& state) {
+    std::string body = AccountBody(state.range(0));
+    SnapshotBuilder builder;
+    ResponseDecoder decoder;
+    for(auto _ : state) {
+        decoder.decode(body);
+        builder.build(CachedAccount {1}, std::string(), std::make_unique<Response>(decoder.response()));
+        std::unique_ptr<TrackSnapshot> snapshot;
+        while(!builder.poll(snapshot)) std::this_thread::yield();
+        benchmark::DoNotOptimize(snapshot->tracks.size());
+        builder.retire(std::move(snapshot));
+    }
+    state.SetBytesProcessed(state.iterations() * body.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AccountToSnapshot)->RangeMultiplier(10)->Range(10, 100000)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+/* Request construction */
+
+/**
+ * What a POST costs the render loop: building the transfer and handing it to the worker
+ * Cancelled right away, mostly before the worker starts it. Without a local server anything that
+ * does go out is refused (the worker still logs each one it starts, use --benchmark_out for clean results).
+ */
+static void BM_MakeAPICall(benchmark::State& state) {
+    static bool initialized = false;
+    if(!initialized) {
+        InitAPI();
+        initialized = true;
+    }
+    std::vector<JournalEntry> entries = SampleEntries(state.range(0));
+    std::string form;
+    EncodeSessionsForm(1, entries, form);
+    APIResponse response;
+    for(auto _ : state) {
+        uint64_t id = MakeAPICall("/sessions", std::string(form));
+        benchmark::DoNotOptimize(id);
+        state.PauseTiming();
+        CancelAPICall(id);
+        while(PollAPI(response)) {}
+        state.ResumeTiming();
+    }
+    state.SetBytesProcessed(state.iterations() * form.size());
+}
+BENCHMARK(BM_MakeAPICall)->Arg(1)->Arg(64);
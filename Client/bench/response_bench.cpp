@@ -0,0 +1,248 @@
+/* Standard headers */
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+/* Third Party headers */
+#include <benchmark/benchmark.h>
+#include <json/json.h>
+
+#include "../responses.h"
+
+/* Allocation counting */
+
+static std::atomic<uint64_t> s_allocations{0};
+
+// Out of line so the compiler cannot pair the inlined malloc/free against operator new/delete
+[[gnu::noinline]] static void* CountedAlloc(size_t size, size_t align = 0) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    if(size == 0) size = 1;
+    void* p = align > alignof(std::max_align_t) ? std::aligned_alloc(align, (size + align - 1) / align * align) : std::malloc(size);
+    if(!p) throw std::bad_alloc();
+    return p;
+}
+
+[[gnu::noinline]] static void CountedFree(void* p) noexcept { std::free(p); }
+
+void* operator new(size_t size) { return CountedAlloc(size); }
+void* operator new[](size_t size) { return CountedAlloc(size); }
+void* operator new(size_t size, std::align_val_t align) { return CountedAlloc(size, static_cast<size_t>(align)); }
+void* operator new[](size_t size, std::align_val_t align) { return CountedAlloc(size, static_cast<size_t>(align)); }
+
+void operator delete(void* p) noexcept { CountedFree(p); }
+void operator delete[](void* p) noexcept { CountedFree(p); }
+void operator delete(void* p, size_t) noexcept { CountedFree(p); }
+void operator delete[](void* p, size_t) noexcept { CountedFree(p); }
+void operator delete(void* p, std::align_val_t) noexcept { CountedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { CountedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { CountedFree(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { CountedFree(p); }
+
+/* Sample bodies, shaped like the server's */
+
+static std::string AccountBody(size_t tracks) {
+    std::string body = R"({"behavior":"ACCOUNT","tracks":[)";
+    for(size_t i = 0; i < tracks; i++) {
+        if(i > 0) body += ',';
+        body += R"({"track":"Project )" + std::to_string(i % 97) + " - task " + std::to_string(i) +
+                R"(","seconds":)" + std::to_string((i * 7919) % 360000) + "}";
+    }
+    body += R"(],"userId":1,"username":"benchmark","seq":)" + std::to_string(tracks) + "}";
+    return body;
+}
+
+static const std::vector<std::string>& SmallBodies() {
+    static const std::vector<std::string> bodies = {
+        R"({"behavior":"TRACKINFO","track":"Project 12 - task 3","seconds":18234})",
+        R"({"behavior":"SAVEACK","message":"Saved!"})",
+        R"({"behavior":"SESSIONACK","message":"Saved!","ids":["9f2c4e0a1b3d5f71","0c1d2e3f40516273"],"tracks":[{"track":"Project 12 - task 3","seconds":18294}]})",
+        R"({"behavior":"CHANGES","seq":412,"etag":"W/\"1-412\"","changes":[{"seq":411,"kind":"seconds","track":"Project 12 - task 3","seconds":18294},{"seq":412,"kind":"rename","track":"Project 4","name":"Project 4b","seconds":60}]})",
+        R"({"behavior":"AUTHENTICATION","username":"benchmark","uid":1})",
+        R"({"message":"Added track!"})",
+        R"({"error":"Track not found."})"
+    };
+    return bodies;
+}
+
+/* Baseline: the jsoncpp path HandleAPIResponse used */
+
+struct LegacyResult {
+    std::string message;
+    uint64_t seconds = 0;
+    size_t tracks = 0;
+    uint64_t checksum = 0;
+};
+
+static void LegacyHandle(const std::string& body, LegacyResult& result) {
+    Json::Reader reader;
+    Json::Value root;
+    if(!reader.parse(body, root)) return;
+
+    if(root.isMember("error")) {
+        result.message = root["error"].asString();
+    } else if(root.isMember("behavior")) {
+        std::string behavior = root["behavior"].asString();
+        result.message = root.isMember("message") ? root["message"].asString() : std::string();
+        if(behavior == "VERSION") {
+            result.message = root["version"].asString();
+        } else if(behavior == "AUTHENTICATION") {
+            result.message = root["username"].asString();
+            result.seconds = root["uid"].asUInt64();
+        } else if(behavior == "ACCOUNT") {
+            Json::StreamWriterBuilder writeBuilder;
+            std::string accountDetails = Json::writeString(writeBuilder, root); // was printed
+            result.checksum += accountDetails.size();
+            for(Json::Value::ArrayIndex i = 0; i != root["tracks"].size(); i++) {
+                const Json::Value& track = root["tracks"][i];
+                std::string name = track["track"].asString();
+                result.checksum += name.size() + track["seconds"].asUInt64();
+                result.tracks++;
+            }
+        } else if(behavior == "CHANGES") {
+            for(const Json::Value& change : root["changes"]) {
+                std::string kind = change["kind"].asString();
+                std::string track = change["track"].asString();
+                result.checksum += kind.size() + track.size() + change["seconds"].asUInt64();
+            }
+        } else if(behavior == "SAVEACK") {
+            result.checksum++;
+        } else if(behavior == "SESSIONACK") {
+            for(const Json::Value& id : root["ids"]) result.checksum += std::strtoull(id.asCString(), nullptr, 16);
+            for(const Json::Value& track : root["tracks"]) result.checksum += track["track"].asString().size() + track["seconds"].asUInt64();
+        } else if(behavior == "TRACKINFO") {
+            result.seconds = root["seconds"].asUInt64();
+        }
+    } else if(root.isMember("message")) {
+        result.message = root["message"].asString();
+    }
+}
+
+/* Decoder path */
+
+static void DecoderHandle(ResponseDecoder& decoder, const std::string& body, LegacyResult& result) {
+    if(!decoder.decode(body)) return;
+    const Response& response = decoder.response();
+
+    if(response.hasError) {
+        result.message.assign(response.error);
+        return;
+    }
+    result.message.assign(response.message);
+    switch(response.behavior) {
+        case Behavior::Version: result.message.assign(response.version); break;
+        case Behavior::Authentication:
+            result.message.assign(response.username);
+            result.seconds = response.userid;
+            break;
+        case Behavior::Account:
+            for(const TrackEntry& track : response.tracks) {
+                result.checksum += track.name.size() + track.seconds;
+                result.tracks++;
+            }
+            break;
+        case Behavior::Changes:
+            for(const TrackChange& change : response.changes) result.checksum += static_cast<uint64_t>(change.kind) + change.track.size() + change.seconds;
+            break;
+        case Behavior::SaveAck: result.checksum++; break;
+        case Behavior::SessionAck:
+            for(uint64_t id : response.ids) result.checksum += id;
+            for(const TrackEntry& track : response.tracks) result.checksum += track.name.size() + track.seconds;
+            break;
+        case Behavior::TrackInfo: result.seconds = response.seconds; break;
+        default: break;
+    }
+}
+
+/* Small responses, one of each kind in turn (the common path) */
+
+static void BM_JsonCppSmall(benchmark::State& state) {
+    const auto& bodies = SmallBodies();
+    LegacyResult result;
+    size_t i = 0;
+    uint64_t allocations = s_allocations.load();
+    for(auto _ : state) {
+        LegacyHandle(bodies[i++ % bodies.size()], result);
+        benchmark::DoNotOptimize(result);
+    }
+    state.counters["allocs/op"] = benchmark::Counter(static_cast<double>(s_allocations.load() - allocations) / state.iterations());
+}
+BENCHMARK(BM_JsonCppSmall);
+
+static void BM_DecoderSmall(benchmark::State& state) {
+    const auto& bodies = SmallBodies();
+    ResponseDecoder decoder;
+    LegacyResult result;
+    for(const auto& body : bodies) DecoderHandle(decoder, body, result); // warm the buffers
+    size_t i = 0;
+    uint64_t allocations = s_allocations.load();
+    for(auto _ : state) {
+        DecoderHandle(decoder, bodies[i++ % bodies.size()], result);
+        benchmark::DoNotOptimize(result);
+    }
+    state.counters["allocs/op"] = benchmark::Counter(static_cast<double>(s_allocations.load() - allocations) / state.iterations());
+}
+BENCHMARK(BM_DecoderSmall);
+
+/* Whole /account responses */
+
+static void BM_JsonCppAccount(benchmark::State& state) {
+    std::string body = AccountBody(state.range(0));
+    LegacyResult result;
+    for(auto _ : state) {
+        LegacyHandle(body, result);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetBytesProcessed(state.iterations() * body.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_JsonCppAccount)->Range(10, 100000);
+
+static void BM_DecoderAccount(benchmark::State& state) {
+    std::string body = AccountBody(state.range(0));
+    ResponseDecoder decoder;
+    LegacyResult result;
+    for(auto _ : state) {
+        DecoderHandle(decoder, body, result);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetBytesProcessed(state.iterations() * body.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DecoderAccount)->Range(10, 100000);
+
+/**
+ * Check both paths read the same values before timing anything
+ */
+static bool PathsAgree() {
+    ResponseDecoder decoder;
+    std::vector<std::string> bodies = SmallBodies();
+    bodies.push_back(AccountBody(1000));
+    for(const auto& body : bodies) {
+        LegacyResult legacy, decoded;
+        LegacyHandle(body, legacy);
+        DecoderHandle(decoder, body, decoded);
+
+        // kinds are counted by name length in one and enum value in the other
+        bool changes = body.find("CHANGES") != std::string::npos;
+        if(legacy.message != decoded.message || legacy.seconds != decoded.seconds || legacy.tracks != decoded.tracks ||
+           (!changes && body.find("ACCOUNT") == std::string::npos && legacy.checksum != decoded.checksum)) {
+            fprintf(stderr, "Paths disagree on %s\n", body.substr(0, 80).c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if(!PathsAgree()) return 1;
+
+    benchmark::Initialize(&argc, argv);
+    if(benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
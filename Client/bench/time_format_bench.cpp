@@ -0,0 +1,149 @@
+/* Standard headers */
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+/* Third Party headers */
+#include <benchmark/benchmark.h>
+
+#include "../time_format.h"
+
+/* Baseline: the std::string based formatter FormatHMS replaced */
+
+static std::string LegacySecondsToHMS(uint64_t seconds) {
+    auto hh = std::chrono::duration_cast<std::chrono::hours>(std::chrono::seconds(seconds));
+    auto mm = std::chrono::duration_cast<std::chrono::minutes>(std::chrono::seconds(seconds) - hh);
+    auto ss = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::seconds(seconds) - hh - mm);
+
+    if(hh.count() > std::chrono::hours::rep(0)) {
+        // HH:MM:SS
+        std::string s_ss = ss.count() > std::chrono::seconds::rep(9) ? std::to_string(ss.count()) : "0" + std::to_string(ss.count());
+        std::string s_mm = mm.count() > std::chrono::minutes::rep(9) ? std::to_string(mm.count()) : "0" + std::to_string(mm.count());
+        std::string s_hh = std::to_string(hh.count());
+
+        return s_hh + ":" + s_mm + ":" + s_ss;
+    } else if(mm.count() > std::chrono::minutes::rep(0)) {
+        // MM:SS
+        std::string s_ss = ss.count() > std::chrono::seconds::rep(9) ? std::to_string(ss.count()) : "0" + std::to_string(ss.count());
+        std::string s_mm = std::to_string(mm.count());
+
+        return s_mm + ":" + s_ss;
+    } else {
+        // SS
+        std::string s_ss = std::to_string(ss.count());
+
+        return s_ss;
+    }
+}
+
+/* Helpers */
+
+/**
+ * Durations spread over the display branches (seconds, minutes, hours)
+ */
+static std::vector<uint64_t> SampleDurations(size_t count) {
+    std::mt19937_64 rng(5540);
+    std::uniform_int_distribution<uint64_t> dist(0, 200ULL * 3600ULL);
+    std::vector<uint64_t> durations(count);
+    for(auto& d : durations) d = dist(rng);
+    return durations;
+}
+
+/* Single value, as drawn by the counting view every frame */
+
+static void BM_LegacySecondsToHMS(benchmark::State& state) {
+    auto durations = SampleDurations(1024);
+    size_t i = 0;
+    for(auto _ : state) {
+        std::string s = LegacySecondsToHMS(durations[i++ & 1023]);
+        benchmark::DoNotOptimize(s.data());
+    }
+}
+BENCHMARK(BM_LegacySecondsToHMS);
+
+static void BM_FormatHMS(benchmark::State& state) {
+    auto durations = SampleDurations(1024);
+    char buf[HMS_BUFFER_SIZE];
+    size_t i = 0;
+    for(auto _ : state) {
+        FormatHMS(durations[i++ & 1023], buf);
+        benchmark::DoNotOptimize(buf);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_FormatHMS);
+
+static void BM_LegacyToString(benchmark::State& state) {
+    auto durations = SampleDurations(1024);
+    size_t i = 0;
+    for(auto _ : state) {
+        std::string s = std::to_string(durations[i++ & 1023]);
+        benchmark::DoNotOptimize(s.data());
+    }
+}
+BENCHMARK(BM_LegacyToString);
+
+static void BM_FormatUInt(benchmark::State& state) {
+    auto durations = SampleDurations(1024);
+    char buf[HMS_BUFFER_SIZE];
+    size_t i = 0;
+    for(auto _ : state) {
+        FormatUInt(durations[i++ & 1023], buf);
+        benchmark::DoNotOptimize(buf);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_FormatUInt);
+
+/* Whole column, e.g. a duration per track in the picker */
+
+static void BM_LegacySecondsToHMSColumn(benchmark::State& state) {
+    auto durations = SampleDurations(state.range(0));
+    std::vector<std::string> column(durations.size());
+    for(auto _ : state) {
+        for(size_t i = 0; i < durations.size(); i++) column[i] = LegacySecondsToHMS(durations[i]);
+        benchmark::DoNotOptimize(column.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LegacySecondsToHMSColumn)->Range(1 << 10, 1 << 17);
+
+static void BM_FormatHMSBulk(benchmark::State& state) {
+    auto durations = SampleDurations(state.range(0));
+    std::vector<char> column(durations.size() * HMS_BUFFER_SIZE);
+    for(auto _ : state) {
+        FormatHMSBulk(durations.data(), durations.size(), column.data(), HMS_BUFFER_SIZE);
+        benchmark::DoNotOptimize(column.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FormatHMSBulk)->Range(1 << 10, 1 << 17);
+
+/**
+ * Check both formatters agree before timing anything
+ */
+static bool FormattersAgree() {
+    char buf[HMS_BUFFER_SIZE];
+    for(uint64_t seconds : SampleDurations(100000)) {
+        FormatHMS(seconds, buf);
+        if(LegacySecondsToHMS(seconds) != buf) {
+            fprintf(stderr, "FormatHMS(%llu) = %s, expected %s\n", static_cast<unsigned long long>(seconds), buf,
+                    LegacySecondsToHMS(seconds).c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if(!FormattersAgree()) return 1;
+
+    benchmark::Initialize(&argc, argv);
+    if(benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,338 @@
+/* Standard headers */
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "account_cache.h" // HashFNV1a
+#include "app_paths.h"
+#include "journal.h"
+#include "network.h" // AppendFormField
+
+/* Record layout */
+
+namespace {
+
+// Gather appends this long before paying for one fsync
+constexpr auto FLUSH_WINDOW = std::chrono::milliseconds(100);
+
+// After a failed write, wait this long before trying the disk again
+constexpr auto RETRY_DELAY = std::chrono::seconds(1);
+
+// Writes tried at shutdown before giving up on them
+constexpr int STOP_ATTEMPTS = 3;
+
+/**
+ * Every record: this header, then id, userid, start, end (8 bytes each) and the track name.
+ * Native byte order, the file never leaves the machine
+ */
+struct RecordHeader {
+    uint32_t length;    // of everything after the header
+    uint32_t checksum;  // low half of HashFNV1a over the same bytes
+};
+
+constexpr size_t RECORD_FIXED = 4 * sizeof(uint64_t);
+
+/**
+ * Append one encoded record
+ * @param entry Entry to encode
+ * @param out Receives the record
+ */
+void EncodeRecord(const JournalEntry& entry, std::string& out) {
+    std::string payload(RECORD_FIXED, '\0');
+    memcpy(payload.data(), &entry.id, 8);
+    memcpy(payload.data() + 8, &entry.userid, 8);
+    memcpy(payload.data() + 16, &entry.start, 8);
+    memcpy(payload.data() + 24, &entry.end, 8);
+    payload += entry.track;
+
+    RecordHeader header {static_cast<uint32_t>(payload.size()), static_cast<uint32_t>(HashFNV1a(payload))};
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out += payload;
+}
+
+/**
+ * Write a buffer and flush it to the disk
+ * @return Boolean for whether everything reached the disk
+ */
+bool WriteDurably(std::FILE* file, const std::string& data) {
+    if(std::fwrite(data.data(), 1, data.size(), file) != data.size() || std::fflush(file) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+} // namespace
+
+/* Method definitions */
+
+void EncodeSessionsForm(uint64_t userid, const std::vector<JournalEntry>& entries, std::string& form) {
+    char number[24];
+    form.clear();
+    snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(userid));
+    AppendFormField(form, "uid", number);
+    for(const JournalEntry& entry : entries) {
+        snprintf(number, sizeof(number), "%016llx", static_cast<unsigned long long>(entry.id));
+        AppendFormField(form, "id", number);
+        AppendFormField(form, "track", entry.track);
+        snprintf(number, sizeof(number), "%lld", static_cast<long long>(entry.start));
+        AppendFormField(form, "start", number);
+        snprintf(number, sizeof(number), "%lld", static_cast<long long>(entry.end));
+        AppendFormField(form, "end", number);
+    }
+}
+
+std::string JournalPath() {
+    return AppFilePath("journal.bin", AppDir::Data);
+}
+
+SessionJournal::~SessionJournal() {
+    close();
+}
+
+bool SessionJournal::open(const std::string& path) {
+    close();
+    m_entries.clear();
+    m_pending.clear();
+    if(path.empty()) return false;
+    m_path = path;
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+    // Replay what an earlier run left behind
+    std::string contents;
+    if(std::FILE* existing = std::fopen(path.c_str(), "rb")) {
+        char chunk[16384];
+        for(size_t read; (read = std::fread(chunk, 1, sizeof(chunk), existing)) > 0;) contents.append(chunk, read);
+        std::fclose(existing);
+    }
+
+    size_t offset = 0;
+    while(contents.size() - offset >= sizeof(RecordHeader)) {
+        RecordHeader header;
+        memcpy(&header, contents.data() + offset, sizeof(header));
+        if(header.length < RECORD_FIXED || header.length > contents.size() - offset - sizeof(header)) break;
+
+        std::string_view payload(contents.data() + offset + sizeof(header), header.length);
+        if(static_cast<uint32_t>(HashFNV1a(payload)) != header.checksum) break;
+
+        JournalEntry entry;
+        memcpy(&entry.id, payload.data(), 8);
+        memcpy(&entry.userid, payload.data() + 8, 8);
+        memcpy(&entry.start, payload.data() + 16, 8);
+        memcpy(&entry.end, payload.data() + 24, 8);
+        entry.track = std::string(payload.substr(RECORD_FIXED));
+        m_entries.push_back(std::move(entry));
+
+        offset += sizeof(header) + header.length;
+    }
+    m_compact = offset != contents.size(); // cut off a torn tail
+
+    m_file = std::fopen(path.c_str(), "ab");
+    if(m_file == nullptr) return false;
+
+    m_stop = false;
+    m_flusher = std::thread(&SessionJournal::run, this);
+    return true;
+}
+
+void SessionJournal::close() {
+    if(m_flusher.joinable()) {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        m_flusher.join();
+    }
+
+    if(m_file != nullptr) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+void SessionJournal::append(uint64_t userid, std::string_view track, int64_t start, int64_t end) {
+    {
+        std::lock_guard lock(m_mutex);
+        JournalEntry entry {m_random(), userid, std::string(track), start, end, true};
+        EncodeRecord(entry, m_pending);
+        m_entries.push_back(std::move(entry));
+    }
+    m_cv.notify_one();
+}
+
+void SessionJournal::release(uint64_t userid, std::string_view track) {
+    std::lock_guard lock(m_mutex);
+    for(JournalEntry& entry : m_entries)
+        if(entry.userid == userid && entry.track == track) entry.held = false;
+}
+
+void SessionJournal::releaseAll(uint64_t userid) {
+    std::lock_guard lock(m_mutex);
+    for(JournalEntry& entry : m_entries)
+        if(entry.userid == userid) entry.held = false;
+}
+
+void SessionJournal::discard(uint64_t userid, std::string_view track) {
+    {
+        std::lock_guard lock(m_mutex);
+        auto removed = std::remove_if(m_entries.begin(), m_entries.end(), [&](const JournalEntry& entry) {
+            return entry.held && entry.userid == userid && entry.track == track;
+        });
+        if(removed == m_entries.end()) return;
+        m_entries.erase(removed, m_entries.end());
+        m_compact = true;
+    }
+    m_cv.notify_one();
+}
+
+void SessionJournal::refuse(const std::vector<uint64_t>& ids) {
+    std::lock_guard lock(m_mutex);
+    for(JournalEntry& entry : m_entries)
+        if(std::find(ids.begin(), ids.end(), entry.id) != ids.end()) entry.refused = true;
+}
+
+void SessionJournal::retry(uint64_t userid, std::string_view track) {
+    std::lock_guard lock(m_mutex);
+    for(JournalEntry& entry : m_entries)
+        if(entry.userid == userid && entry.track == track) entry.refused = false;
+}
+
+void SessionJournal::forget(uint64_t userid, std::string_view track) {
+    {
+        std::lock_guard lock(m_mutex);
+        auto removed = std::remove_if(m_entries.begin(), m_entries.end(), [&](const JournalEntry& entry) {
+            return entry.userid == userid && entry.track == track;
+        });
+        if(removed == m_entries.end()) return;
+        m_entries.erase(removed, m_entries.end());
+        m_compact = true;
+    }
+    m_cv.notify_one();
+}
+
+void SessionJournal::rename(uint64_t userid, std::string_view from, std::string_view to) {
+    {
+        std::lock_guard lock(m_mutex);
+        bool renamed = false;
+        for(JournalEntry& entry : m_entries) {
+            if(entry.userid != userid || entry.track != from) continue;
+            entry.track.assign(to);
+            entry.refused = false;
+            renamed = true;
+        }
+        if(!renamed) return;
+        m_compact = true; // the file still has the old names
+    }
+    m_cv.notify_one();
+}
+
+void SessionJournal::batch(uint64_t userid, size_t maxEntries, std::vector<JournalEntry>& out) const {
+    out.clear();
+    std::lock_guard lock(m_mutex);
+    for(const JournalEntry& entry : m_entries) {
+        if(out.size() >= maxEntries) break;
+        if(!entry.held && !entry.refused && entry.userid == userid) out.push_back(entry);
+    }
+}
+
+void SessionJournal::acknowledge(const std::vector<uint64_t>& ids) {
+    {
+        std::lock_guard lock(m_mutex);
+        auto removed = std::remove_if(m_entries.begin(), m_entries.end(), [&](const JournalEntry& entry) {
+            return std::find(ids.begin(), ids.end(), entry.id) != ids.end();
+        });
+        if(removed == m_entries.end()) return;
+        m_entries.erase(removed, m_entries.end());
+        m_compact = true;
+    }
+    m_cv.notify_one();
+}
+
+uint64_t SessionJournal::unsentSeconds(uint64_t userid, std::string_view track) const {
+    uint64_t seconds = 0;
+    std::lock_guard lock(m_mutex);
+    for(const JournalEntry& entry : m_entries)
+        if(!entry.held && !entry.refused && entry.userid == userid && entry.track == track && entry.end > entry.start)
+            seconds += static_cast<uint64_t>(entry.end - entry.start);
+    return seconds;
+}
+
+void SessionJournal::run() {
+    std::unique_lock lock(m_mutex);
+    int failures = 0;
+    while(true) {
+        m_cv.wait(lock, [this] { return m_stop || m_compact || !m_pending.empty(); });
+
+        // Let more appends pile up, one fsync covers them all
+        if(!m_stop) m_cv.wait_for(lock, failures > 0 ? RETRY_DELAY : FLUSH_WINDOW, [this] { return m_stop; });
+
+        bool written = true;
+        if(m_compact) {
+            // The rewrite covers the pending appends too
+            std::string records;
+            for(const JournalEntry& entry : m_entries) EncodeRecord(entry, records);
+            m_pending.clear();
+            m_compact = false;
+
+            lock.unlock();
+            written = rewrite(records);
+            lock.lock();
+            if(!written) fprintf(stderr, "Could not compact the journal %s\n", m_path.c_str());
+        } else if(!m_pending.empty()) {
+            std::string records;
+            records.swap(m_pending);
+
+            lock.unlock();
+            written = m_file != nullptr && WriteDurably(m_file, records);
+            lock.lock();
+            if(!written) fprintf(stderr, "Could not write the journal %s\n", m_path.c_str());
+        }
+
+        if(written) failures = 0;
+        else {
+            // The file may end in part of a record now, rewrite it whole from the entries (which hold
+            // everything that was pending) once the disk takes writes again
+            m_pending.clear();
+            m_compact = true;
+            failures++;
+            if(m_stop && failures >= STOP_ATTEMPTS) {
+                fprintf(stderr, "Giving up on the journal %s, %zu intervals are not saved\n", m_path.c_str(), m_entries.size());
+                break;
+            }
+        }
+
+        if(m_stop && !m_compact && m_pending.empty()) break;
+    }
+}
+
+bool SessionJournal::rewrite(const std::string& records) {
+    std::filesystem::path temporary = m_path;
+    temporary += ".tmp";
+
+    std::FILE* file = std::fopen(temporary.string().c_str(), "wb");
+    if(file == nullptr) return false;
+    bool written = WriteDurably(file, records);
+    std::fclose(file);
+    if(!written) return false;
+
+    // Swap the files, then keep appending to the new one
+    if(m_file != nullptr) std::fclose(m_file);
+    m_file = nullptr;
+    std::error_code error;
+    std::filesystem::rename(temporary, m_path, error);
+    if(error) return false; // never append to the old file, the next attempt rewrites it
+    m_file = std::fopen(m_path.c_str(), "ab");
+    return m_file != nullptr;
+}
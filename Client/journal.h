@@ -0,0 +1,176 @@
+#pragma once
+
+/* Standard headers */
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/* Session journal */
+
+/**
+ * One counted interval
+ */
+struct JournalEntry {
+    uint64_t id{};          // random, lets the server ignore replays
+    uint64_t userid{};
+    std::string track{};
+    int64_t start{};        // seconds since the epoch
+    int64_t end{};
+    bool held{};            // not saved by the user yet, kept out of uploads (not persisted)
+    bool refused{};         // the server has no such track, kept out of uploads (not persisted)
+};
+
+/**
+ * Encode a batch as a /sessions form body: uid, then id (16 hex digits), track, start and end per entry
+ * @param userid Owner of the entries
+ * @param entries The batch
+ * @param form Receives the body, its memory is reused
+ */
+void EncodeSessionsForm(uint64_t userid, const std::vector<JournalEntry>& entries, std::string& form);
+
+/**
+ * Where the journal lives: $XDG_DATA_HOME (or ~/.local/share) /timetracker/journal.bin,
+ * %LOCALAPPDATA%\TimeTracker\journal.bin on Windows
+ * @return Journal file path, empty if no suitable directory exists
+ */
+std::string JournalPath();
+
+/**
+ * Append-only on-disk log of counted intervals that have not reached the server yet
+ * Appends are written and fsync'd by a background thread in batches (group commit), so
+ * stopping the counter never waits for the disk. Acknowledged or discarded entries are
+ * compacted away by rewriting the file, which is also how a failed write is retried.
+ * Entries left over from an earlier run are never held, they upload as soon as their
+ * user signs in.
+ */
+class SessionJournal {
+public:
+    SessionJournal() = default;
+    ~SessionJournal();
+
+    SessionJournal(const SessionJournal&) = delete;
+    SessionJournal& operator=(const SessionJournal&) = delete;
+
+    /**
+     * Load the journal and start the flusher thread
+     * A torn or corrupt tail (e.g. from a crash mid-write) is dropped.
+     * @param path Journal file path
+     * @return Boolean for whether the journal file could be opened
+     */
+    bool open(const std::string& path);
+
+    /**
+     * Write out everything still pending and stop the flusher thread
+     */
+    void close();
+
+    /**
+     * Record an interval, held until release()
+     * @param userid Owner of the track
+     * @param track Track name
+     * @param start Start in seconds since the epoch
+     * @param end End in seconds since the epoch
+     */
+    void append(uint64_t userid, std::string_view track, int64_t start, int64_t end);
+
+    /**
+     * Let the held intervals of a track upload
+     * @param userid Owner of the track
+     * @param track Track name
+     */
+    void release(uint64_t userid, std::string_view track);
+
+    /**
+     * Let every held interval of a user upload
+     * @param userid Owner of the tracks
+     */
+    void releaseAll(uint64_t userid);
+
+    /**
+     * Drop the held intervals of a track
+     * @param userid Owner of the track
+     * @param track Track name
+     */
+    void discard(uint64_t userid, std::string_view track);
+
+    /**
+     * Keep intervals the server refused (their track does not exist there) out of uploads and totals
+     * until their track shows up again, see retry(), rename() and forget()
+     * @param ids Ids of the refused intervals
+     */
+    void refuse(const std::vector<uint64_t>& ids);
+
+    /**
+     * Let the refused intervals of a track upload again, e.g. once the server has the track
+     * @param userid Owner of the track
+     * @param track Track name
+     */
+    void retry(uint64_t userid, std::string_view track);
+
+    /**
+     * Drop every interval of a track the server deleted, they can never be stored
+     * @param userid Owner of the track
+     * @param track Track name
+     */
+    void forget(uint64_t userid, std::string_view track);
+
+    /**
+     * Move every interval of a track to its new name (refused ones upload again), so uploads find the renamed track
+     * @param userid Owner of the track
+     * @param from Old track name
+     * @param to New track name
+     */
+    void rename(uint64_t userid, std::string_view from, std::string_view to);
+
+    /**
+     * Next intervals to upload, oldest first
+     * @param userid Owner of the tracks
+     * @param maxEntries Largest batch
+     * @param out Receives the entries
+     */
+    void batch(uint64_t userid, size_t maxEntries, std::vector<JournalEntry>& out) const;
+
+    /**
+     * Drop intervals the server has recorded
+     * @param ids Ids of the recorded intervals
+     */
+    void acknowledge(const std::vector<uint64_t>& ids);
+
+    /**
+     * @param userid Owner of the track
+     * @param track Track name
+     * @return Seconds released for upload but not acknowledged yet
+     */
+    uint64_t unsentSeconds(uint64_t userid, std::string_view track) const;
+
+private:
+    std::string m_path;
+    std::FILE* m_file = nullptr;    // flusher thread only, once started
+    std::thread m_flusher;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<JournalEntry> m_entries;    // unacknowledged, oldest first
+    std::string m_pending;                  // encoded appends not written yet
+    bool m_compact = false;                 // entries were removed, rewrite the file
+    bool m_stop = false;
+    std::mt19937_64 m_random{std::random_device{}()};
+
+    /**
+     * Flusher loop: gather appends for a short window, then write and fsync them at once
+     */
+    void run();
+
+    /**
+     * Replace the file with the current entries
+     * @param records Encoded entries
+     * @return Boolean for whether the file was replaced
+     */
+    bool rewrite(const std::string& records);
+};
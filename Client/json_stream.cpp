@@ -0,0 +1,293 @@
+/* Standard headers */
+#include <algorithm>
+
+#include "json_stream.h"
+
+/* Method definitions */
+
+JsonStreamParser::JsonStreamParser(JsonHandler& handler) : m_handler(handler) {
+    m_stack.reserve(16);
+}
+
+void JsonStreamParser::reset() {
+    m_stack.clear();
+    m_scratch.clear();
+    m_error.clear();
+    m_state = State::Value;
+    m_stringIsKey = false;
+    m_started = false;
+    m_literalPos = 0;
+    m_highSurrogate = 0;
+    m_hexDigits = 0;
+    m_offset = 0;
+}
+
+bool JsonStreamParser::fail(const char* what, size_t at) {
+    if(m_error.empty()) m_error = std::string(what) + " at byte " + std::to_string(m_offset + at);
+    return false;
+}
+
+void JsonStreamParser::valueDone() {
+    m_state = m_stack.empty() ? State::Done : State::Next;
+}
+
+void JsonStreamParser::appendUTF8(uint32_t codepoint) {
+    if(codepoint < 0x80) {
+        m_scratch += static_cast<char>(codepoint);
+    } else if(codepoint < 0x800) {
+        m_scratch += static_cast<char>(0xC0 | (codepoint >> 6));
+        m_scratch += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else if(codepoint < 0x10000) {
+        m_scratch += static_cast<char>(0xE0 | (codepoint >> 12));
+        m_scratch += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        m_scratch += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else {
+        m_scratch += static_cast<char>(0xF0 | (codepoint >> 18));
+        m_scratch += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+        m_scratch += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        m_scratch += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+}
+
+bool JsonStreamParser::feed(std::string_view chunk) {
+    if(!m_error.empty()) return false;
+    if(!chunk.empty()) m_started = true;
+
+    auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+    auto isNumber = [](char c) { return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'; };
+
+    const char* const begin = chunk.data();
+    const char* const end = begin + chunk.size();
+    const char* p = begin;
+    const char* token = begin;  // start of the string or number in this chunk
+
+    while(p < end) {
+        switch(m_state) {
+            case State::String: {
+                // Only an escape right away can complete a pending surrogate pair
+                if(m_highSurrogate != 0 && *p != '\\') {
+                    appendUTF8(0xFFFD);
+                    m_highSurrogate = 0;
+                }
+
+                // Fast path: run to the closing quote or the next escape
+                const char* stop = std::find_if(p, end, [](char c) { return c == '"' || c == '\\'; });
+                if(stop == end) {
+                    m_scratch.append(token, end);
+                    p = end;
+                    break;
+                }
+
+                if(*stop == '\\') {
+                    m_scratch.append(token, stop);
+                    m_state = State::Escape;
+                    p = stop + 1;
+                    break;
+                }
+
+                // Closing quote. Nothing buffered means the whole string is in this chunk
+                std::string_view value;
+                if(m_scratch.empty()) value = std::string_view(token, stop - token);
+                else {
+                    m_scratch.append(token, stop);
+                    value = m_scratch;
+                }
+                p = stop + 1;
+
+                if(m_stringIsKey) {
+                    m_handler.key(value);
+                    m_state = State::Colon;
+                } else {
+                    m_handler.string(value);
+                    valueDone();
+                }
+                m_scratch.clear();
+                break;
+            }
+
+            case State::Escape: {
+                char c = *p++;
+                if(m_highSurrogate != 0 && c != 'u') {
+                    appendUTF8(0xFFFD);
+                    m_highSurrogate = 0;
+                }
+                switch(c) {
+                    case '"': m_scratch += '"'; break;
+                    case '\\': m_scratch += '\\'; break;
+                    case '/': m_scratch += '/'; break;
+                    case 'b': m_scratch += '\b'; break;
+                    case 'f': m_scratch += '\f'; break;
+                    case 'n': m_scratch += '\n'; break;
+                    case 'r': m_scratch += '\r'; break;
+                    case 't': m_scratch += '\t'; break;
+                    case 'u':
+                        m_codepoint = 0;
+                        m_hexDigits = 0;
+                        m_state = State::Unicode;
+                        continue;
+                    default:
+                        return fail("Invalid escape", p - 1 - begin);
+                }
+                m_state = State::String;
+                token = p;
+                break;
+            }
+
+            case State::Unicode: {
+                char c = *p++;
+                uint32_t digit;
+                if(c >= '0' && c <= '9') digit = c - '0';
+                else if(c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+                else if(c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+                else return fail("Invalid \\u escape", p - 1 - begin);
+
+                m_codepoint = (m_codepoint << 4) | digit;
+                if(++m_hexDigits < 4) break;
+
+                // UTF-16 surrogate pairs arrive as two escapes, lone halves become U+FFFD
+                if(m_codepoint >= 0xD800 && m_codepoint <= 0xDBFF) {
+                    if(m_highSurrogate != 0) appendUTF8(0xFFFD);
+                    m_highSurrogate = m_codepoint;
+                } else if(m_codepoint >= 0xDC00 && m_codepoint <= 0xDFFF) {
+                    appendUTF8(m_highSurrogate != 0 ? 0x10000 + ((m_highSurrogate - 0xD800) << 10) + (m_codepoint - 0xDC00) : 0xFFFD);
+                    m_highSurrogate = 0;
+                } else {
+                    if(m_highSurrogate != 0) appendUTF8(0xFFFD);
+                    m_highSurrogate = 0;
+                    appendUTF8(m_codepoint);
+                }
+                m_state = State::String;
+                token = p;
+                break;
+            }
+
+            case State::Number: {
+                const char* stop = std::find_if_not(p, end, isNumber);
+                if(stop == end) {
+                    m_scratch.append(token, end);
+                    p = end;
+                    break;
+                }
+
+                std::string_view text;
+                if(m_scratch.empty()) text = std::string_view(token, stop - token);
+                else {
+                    m_scratch.append(token, stop);
+                    text = m_scratch;
+                }
+                m_handler.number(text);
+                m_scratch.clear();
+                p = stop;
+                valueDone();
+                break;
+            }
+
+            case State::Literal: {
+                if(*p != m_literal[m_literalPos]) return fail("Invalid literal", p - begin);
+                p++;
+                if(++m_literalPos < m_literal.size()) break;
+
+                if(m_literal[0] == 'n') m_handler.null();
+                else m_handler.boolean(m_literal[0] == 't');
+                valueDone();
+                break;
+            }
+
+            default: {
+                char c = *p;
+                if(isSpace(c)) {
+                    p++;
+                    break;
+                }
+
+                switch(m_state) {
+                    case State::ObjectStart:
+                    case State::Key:
+                        if(c == '}' && m_state == State::ObjectStart) {
+                            m_stack.pop_back();
+                            m_handler.endObject();
+                            valueDone();
+                        } else if(c == '"') {
+                            m_stringIsKey = true;
+                            m_state = State::String;
+                            token = p + 1;
+                        } else return fail("Expected a member name", p - begin);
+                        p++;
+                        break;
+
+                    case State::Colon:
+                        if(c != ':') return fail("Expected ':'", p - begin);
+                        m_state = State::Value;
+                        p++;
+                        break;
+
+                    case State::Next:
+                        if(c == ',') m_state = m_stack.back() == '{' ? State::Key : State::Value;
+                        else if(c == (m_stack.back() == '{' ? '}' : ']')) {
+                            bool object = m_stack.back() == '{';
+                            m_stack.pop_back();
+                            if(object) m_handler.endObject();
+                            else m_handler.endArray();
+                            valueDone();
+                        } else return fail("Expected ',' or a closing bracket", p - begin);
+                        p++;
+                        break;
+
+                    case State::Done:
+                        return fail("Trailing data", p - begin);
+
+                    default:
+                        // State::Value or State::ArrayStart
+                        if(c == ']' && m_state == State::ArrayStart) {
+                            m_stack.pop_back();
+                            m_handler.endArray();
+                            valueDone();
+                            p++;
+                        } else if(c == '{' || c == '[') {
+                            if(m_stack.size() == MAX_DEPTH) return fail("Nested too deep", p - begin);
+                            m_stack.push_back(c);
+                            if(c == '{') {
+                                m_handler.beginObject();
+                                m_state = State::ObjectStart;
+                            } else {
+                                m_handler.beginArray();
+                                m_state = State::ArrayStart;
+                            }
+                            p++;
+                        } else if(c == '"') {
+                            m_stringIsKey = false;
+                            m_state = State::String;
+                            token = ++p;
+                        } else if(c == '-' || (c >= '0' && c <= '9')) {
+                            m_state = State::Number;
+                            token = p;
+                        } else if(c == 't' || c == 'f' || c == 'n') {
+                            m_literal = c == 't' ? "true" : c == 'f' ? "false" : "null";
+                            m_literalPos = 0;
+                            m_state = State::Literal;
+                        } else return fail("Unexpected character", p - begin);
+                        break;
+                }
+                break;
+            }
+        }
+    }
+
+    m_offset += chunk.size();
+    return true;
+}
+
+bool JsonStreamParser::finish() {
+    if(!m_error.empty()) return false;
+
+    // A number only ends at the next byte, a document that is one number ends with the input
+    if(m_state == State::Number && m_stack.empty()) {
+        m_handler.number(m_scratch);
+        m_scratch.clear();
+        m_state = State::Done;
+    }
+
+    if(!m_started) return fail("Empty document", 0);
+    if(m_state != State::Done) return fail("Unexpected end of document", 0);
+    return true;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+/* Standard headers */
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Incremental JSON parsing */
+
+/**
+ * Receives the tokens of a JSON document in order (SAX style)
+ * Views passed to the callbacks are only valid during the call.
+ */
+class JsonHandler {
+public:
+    virtual ~JsonHandler() = default;
+
+    virtual void beginObject() {}
+    virtual void endObject() {}
+    virtual void beginArray() {}
+    virtual void endArray() {}
+
+    /**
+     * Object member name, the member value follows
+     * @param name Unescaped name
+     */
+    virtual void key(std::string_view name) { (void)name; }
+
+    /**
+     * @param value Unescaped string
+     */
+    virtual void string(std::string_view value) { (void)value; }
+
+    /**
+     * @param text The number as written, for std::from_chars
+     */
+    virtual void number(std::string_view text) { (void)text; }
+
+    virtual void boolean(bool value) { (void)value; }
+    virtual void null() {}
+};
+
+/**
+ * Push parser for one JSON document that arrives in pieces
+ * Each byte is looked at once, chunk boundaries may fall anywhere (inside strings, escapes, numbers).
+ * Tokens that fit in one chunk are passed as views into it, only split or escaped ones are copied,
+ * into a buffer that is kept between documents.
+ */
+class JsonStreamParser {
+public:
+    explicit JsonStreamParser(JsonHandler& handler);
+
+    /**
+     * Parse the next piece of the document
+     * @param chunk Bytes following the previous chunk
+     * @return Boolean for whether the document is still valid
+     */
+    bool feed(std::string_view chunk);
+
+    /**
+     * End of input
+     * @return Boolean for whether exactly one complete document was parsed
+     */
+    bool finish();
+
+    /**
+     * Start over with a new document, keeping the buffers
+     */
+    void reset();
+
+    /**
+     * @return Description of the first error, empty if none
+     */
+    const std::string& error() const { return m_error; }
+
+private:
+    enum class State : uint8_t {
+        Value,          // any value
+        ArrayStart,     // a value or ]
+        ObjectStart,    // a key or }
+        Key,            // a key
+        Colon,
+        Next,           // , or the closing bracket
+        String,
+        Escape,
+        Unicode,
+        Number,
+        Literal,
+        Done
+    };
+
+    static constexpr size_t MAX_DEPTH = 512;
+
+    JsonHandler& m_handler;
+    std::vector<char> m_stack;      // open containers, '{' or '['
+    std::string m_scratch;          // token split across chunks or unescaped
+    std::string m_error;
+    State m_state = State::Value;
+    bool m_stringIsKey = false;
+    bool m_started = false;
+    std::string_view m_literal;     // true, false or null
+    size_t m_literalPos = 0;
+    uint32_t m_codepoint = 0;       // \uXXXX being read
+    uint32_t m_highSurrogate = 0;
+    int m_hexDigits = 0;
+    uint64_t m_offset = 0;          // bytes before the current chunk, for error messages
+
+    /**
+     * Record the first error
+     * @param what Description
+     * @param at Offset in the current chunk
+     * @return false
+     */
+    bool fail(const char* what, size_t at);
+
+    /**
+     * Continue after a complete value
+     */
+    void valueDone();
+
+    /**
+     * Append a code point as UTF-8 to m_scratch
+     * @param codepoint Unicode scalar value
+     */
+    void appendUTF8(uint32_t codepoint);
+};
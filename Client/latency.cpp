@@ -0,0 +1,118 @@
+/* Standard headers */
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#include "app_paths.h"
+#include "latency.h"
+
+/* Method definitions */
+
+size_t LatencyHistogram::bucket(uint64_t value) {
+    // The top SUB_BITS + 1 significant bits pick the bucket, values below 2^(SUB_BITS + 1) are exact
+    unsigned width = static_cast<unsigned>(std::bit_width(value));
+    unsigned shift = width > SUB_BITS + 1 ? width - (SUB_BITS + 1) : 0U;
+    return (static_cast<size_t>(shift) << SUB_BITS) + static_cast<size_t>(value >> shift);
+}
+
+uint64_t LatencyHistogram::lowest(size_t bucket) {
+    size_t shift = bucket < (2U << SUB_BITS) ? 0U : (bucket >> SUB_BITS) - 1U;
+    return static_cast<uint64_t>(bucket - (shift << SUB_BITS)) << shift;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    value = std::min<uint64_t>(value, (uint64_t {1} << MAX_BITS) - 1U);
+    m_counts[bucket(value)]++;
+    m_min = m_count == 0U ? value : std::min(m_min, value);
+    m_max = std::max(m_max, value);
+    m_sum += value;
+    m_count++;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if(m_count == 0U) return 0U;
+    if(p >= 100.0) return m_max;
+
+    uint64_t rank = std::max<uint64_t>(1U, static_cast<uint64_t>(std::ceil(p / 100.0 * m_count)));
+    uint64_t seen = 0;
+    for(size_t i = 0; i < BUCKETS; i++) {
+        seen += m_counts[i];
+        if(seen < rank) continue;
+        uint64_t low = lowest(i), high = i + 1U < BUCKETS ? lowest(i + 1U) : low + 1U;
+        return std::clamp(low + (high - low) / 2U, m_min, m_max);
+    }
+    return m_max;
+}
+
+void LatencyHistogram::buckets(std::vector<std::pair<uint64_t, uint64_t>>& out) const {
+    out.clear();
+    for(size_t i = 0; i < BUCKETS; i++)
+        if(m_counts[i] != 0U) out.emplace_back(lowest(i), m_counts[i]);
+}
+
+const char* LatencyPhaseName(LatencyPhase phase) {
+    switch(phase) {
+        case LatencyPhase::Queue: return "queue";
+        case LatencyPhase::DNS: return "dns";
+        case LatencyPhase::Connect: return "connect";
+        case LatencyPhase::TLS: return "tls";
+        case LatencyPhase::FirstByte: return "first_byte";
+        case LatencyPhase::Total: return "total";
+        case LatencyPhase::Parse: return "parse";
+        default: return "unknown";
+    }
+}
+
+void LatencyStats::record(std::string_view endpoint, const RequestTiming& timing) {
+    // A handful of endpoints, a scan is cheaper than hashing
+    auto it = std::find_if(m_endpoints.begin(), m_endpoints.end(), [endpoint](const Endpoint& e) { return e.name == endpoint; });
+    if(it == m_endpoints.end()) it = m_endpoints.insert(m_endpoints.end(), Endpoint {std::string(endpoint)});
+
+    const uint64_t values[] = {timing.queue, timing.dns, timing.connect, timing.tls, timing.firstByte, timing.total, timing.parse};
+    for(size_t i = 0; i < std::size(values); i++) it->phases[i].record(values[i]);
+}
+
+bool LatencyStats::dump(const std::string& path) const {
+    if(path.empty()) return false;
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+    // {"unit":"us","endpoints":{"/login":{"total":{"count":..,"p50":..,"buckets":[[lowest,count],..]},..},..}}
+    std::string json = R"({"unit":"us","endpoints":{)";
+    std::vector<std::pair<uint64_t, uint64_t>> buckets;
+    char field[256];
+    for(size_t e = 0; e < m_endpoints.size(); e++) {
+        const Endpoint& endpoint = m_endpoints[e];
+        json += e > 0 ? ",\"" : "\"";
+        json += endpoint.name + "\":{";
+        for(size_t i = 0; i < endpoint.phases.size(); i++) {
+            const LatencyHistogram& histogram = endpoint.phases[i];
+            snprintf(field, sizeof(field), R"(%s"%s":{"count":%llu,"min":%llu,"mean":%.1f,"p50":%llu,"p90":%llu,"p99":%llu,"p999":%llu,"max":%llu,"buckets":[)",
+                     i > 0 ? "," : "", LatencyPhaseName(static_cast<LatencyPhase>(i)), static_cast<unsigned long long>(histogram.count()),
+                     static_cast<unsigned long long>(histogram.min()), histogram.mean(), static_cast<unsigned long long>(histogram.percentile(50.0)),
+                     static_cast<unsigned long long>(histogram.percentile(90.0)), static_cast<unsigned long long>(histogram.percentile(99.0)),
+                     static_cast<unsigned long long>(histogram.percentile(99.9)), static_cast<unsigned long long>(histogram.max()));
+            json += field;
+            histogram.buckets(buckets);
+            for(size_t b = 0; b < buckets.size(); b++) {
+                snprintf(field, sizeof(field), "%s[%llu,%llu]", b > 0 ? "," : "", static_cast<unsigned long long>(buckets[b].first),
+                         static_cast<unsigned long long>(buckets[b].second));
+                json += field;
+            }
+            json += "]}";
+        }
+        json += "}";
+    }
+    json += "}}\n";
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(json.data(), static_cast<std::streamsize>(json.size()));
+    return static_cast<bool>(out);
+}
+
+std::string LatencyReportPath() {
+    return AppFilePath("latency.json", AppDir::Cache);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+/* Standard headers */
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "network.h"
+
+/* Latency statistics */
+
+/**
+ * Histogram of microsecond values with log-linear buckets, in the style of HdrHistogram
+ * Every power of two is split into 16 buckets, so percentiles are within about 3% of the true
+ * value from 1us up to days. Recording is an index computation and an increment, no allocation.
+ */
+class LatencyHistogram {
+public:
+    /**
+     * @param value Value in microseconds, larger than the range counts as the top bucket
+     */
+    void record(uint64_t value);
+
+    /**
+     * @param p Percentile, 0 to 100
+     * @return Value at the percentile (midpoint of its bucket), 0 if nothing was recorded
+     */
+    uint64_t percentile(double p) const;
+
+    uint64_t count() const { return m_count; }
+    uint64_t min() const { return m_count > 0U ? m_min : 0U; }
+    uint64_t max() const { return m_max; }
+    double mean() const { return m_count > 0U ? static_cast<double>(m_sum) / m_count : 0.0; }
+
+    /**
+     * Recorded buckets as {lowest value of the bucket, count}, for merging histograms elsewhere
+     * @param out Receives the non-empty buckets, lowest first
+     */
+    void buckets(std::vector<std::pair<uint64_t, uint64_t>>& out) const;
+
+private:
+    static constexpr unsigned SUB_BITS = 4;                 // 16 buckets per power of two
+    static constexpr unsigned MAX_BITS = 40;                // ~12 days in microseconds
+    static constexpr size_t BUCKETS = (MAX_BITS - SUB_BITS + 1) << SUB_BITS;
+
+    std::array<uint32_t, BUCKETS> m_counts{};
+    uint64_t m_count{};
+    uint64_t m_sum{};
+    uint64_t m_min{};
+    uint64_t m_max{};
+
+    static size_t bucket(uint64_t value);
+    static uint64_t lowest(size_t bucket);
+};
+
+/**
+ * Phases of a request, in the order of RequestTiming
+ */
+enum class LatencyPhase {
+    Queue,
+    DNS,
+    Connect,
+    TLS,
+    FirstByte,
+    Total,
+    Parse,
+    Count
+};
+
+/**
+ * @param phase A phase
+ * @return Short name, as used in the report
+ */
+const char* LatencyPhaseName(LatencyPhase phase);
+
+/**
+ * Histograms of every phase, per endpoint (render loop only)
+ */
+class LatencyStats {
+public:
+    struct Endpoint {
+        std::string name;
+        std::array<LatencyHistogram, static_cast<size_t>(LatencyPhase::Count)> phases{};
+
+        const LatencyHistogram& operator[](LatencyPhase phase) const { return phases[static_cast<size_t>(phase)]; }
+    };
+
+    /**
+     * Add a completed call
+     * @param endpoint Endpoint it went to, e.g. "/login"
+     * @param timing Its timing
+     */
+    void record(std::string_view endpoint, const RequestTiming& timing);
+
+    /**
+     * @return Every endpoint that was called, in order of first call
+     */
+    const std::vector<Endpoint>& endpoints() const { return m_endpoints; }
+
+    /**
+     * Write every histogram to a JSON file
+     * @param path Report file path
+     * @return Boolean for whether the file was written
+     */
+    bool dump(const std::string& path) const;
+
+private:
+    std::vector<Endpoint> m_endpoints;
+};
+
+/**
+ * Where the latency report goes: $XDG_CACHE_HOME (or ~/.cache) /timetracker/latency.json,
+ * %LOCALAPPDATA%\TimeTracker\latency.json on Windows
+ * @return Report file path, empty if no suitable directory exists
+ */
+std::string LatencyReportPath();
@@ -4,6 +4,15 @@
 #include <future>
 #include <algorithm>
 #include <format>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <fstream>
 
 /* Third Party headers */
 #define RAYGUI_IMPLEMENTATION
@@ -13,19 +22,48 @@ extern "C" {
 #include "cyber/style_cyber.h"
 };
 #include <curl/curl.h>
-#include <json/json.h>
 
-#define BASE_API_URL "http://127.0.0.1"
-#define BASE_API_PORT 5540
+#include "account_cache.h"
+#include "api_tasks.h"
+#include "journal.h"
+#include "latency.h"
+#include "network.h"
+#include "profiler.h"
+#include "responses.h"
+#include "snapshots.h"
+#include "time_format.h"
+#include "trace.h"
+#include "tracks.h"
+
 #define DEFAULT_WIN_TITLE "Time Tracker: Log work time!"
 
+#ifdef TIMETRACKER_GLFW_WAKEUP
+// raylib desktop builds embed GLFW, this is safe to call from any thread
+extern "C" void glfwPostEmptyEvent(void);
+#endif
+
+#ifdef TIMETRACKER_DRAW_CALLS
+// raylib desktop builds embed glad, whose GL entry points are function pointers the UI benchmark wraps.
+// They use the GL calling convention (glad's APIENTRY), which only differs on 32-bit Windows
+#if defined(_WIN32) && !defined(_WIN64)
+#define TIMETRACKER_GL_APIENTRY __stdcall
+#else
+#define TIMETRACKER_GL_APIENTRY
+#endif
+extern "C" {
+using GLDrawArraysProc = void (TIMETRACKER_GL_APIENTRY *)(unsigned int mode, int first, int count);
+using GLDrawElementsProc = void (TIMETRACKER_GL_APIENTRY *)(unsigned int mode, int count, unsigned int type, const void* indices);
+extern GLDrawArraysProc glad_glDrawArrays;
+extern GLDrawElementsProc glad_glDrawElements;
+}
+#endif
+
 /**
  * TODO: Add functionality to edit the time on a track
  * TODO: Prompt before track delete
  * TODO: Add functionality to HEARTBEAT the server for status
  * TODO: JSON Web Tokens (JWT) + Periodic automatic re-auth
  * TODO: Add functionality to change the server address
- * TODO: Add functionality to save/load for offline usage
  * TODO: Harden the security a tad
  * TODO: Refactor for niceness
  */
@@ -40,9 +78,52 @@ inline Color RGBToColor(unsigned char r, unsigned char g, unsigned char b) {
     return Color(r, g, b, 255U);
 }
 
-/* API implementation */
+/**
+ * Wake the render loop if it is blocked waiting for input
+ * Called from the network worker when a response was queued
+ */
+static void WakeRenderLoop() {
+#ifdef TIMETRACKER_GLFW_WAKEUP
+    glfwPostEmptyEvent();
+#endif
+}
 
-typedef std::future<std::pair<bool, std::string>> APIResult;
+/* Render loop scheduling */
+
+/**
+ * Wakes the render loop once per second while something on screen depends on the clock, and
+ * when background work is due (see NextDeadline())
+ * Used in on-demand rendering, where EndDrawing() otherwise blocks until input arrives
+ */
+class RenderTicker {
+public:
+    RenderTicker();
+    ~RenderTicker();
+
+    /**
+     * Start, move or stop the ticks
+     * @param anchor Tick right after every whole second counted from this point, or std::nullopt to stop
+     */
+    void tick(std::optional<std::chrono::time_point<std::chrono::system_clock>> anchor);
+
+    /**
+     * Wake the loop once at a point in time, on top of the ticks
+     * @param deadline When, or std::nullopt for no wake-up
+     */
+    void wakeAt(std::optional<std::chrono::time_point<std::chrono::steady_clock>> deadline);
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::optional<std::chrono::time_point<std::chrono::system_clock>> m_anchor{};
+    std::optional<std::chrono::time_point<std::chrono::steady_clock>> m_deadline{};
+    bool m_stop = false;
+    std::thread m_thread;
+
+    void run();
+};
+
+/* API implementation */
 
 struct AuthToken {
     std::string token;
@@ -51,24 +132,6 @@ struct AuthToken {
     std::chrono::time_point<std::chrono::system_clock> expiration;
 };
 
-/**
- * libcurl curl_easy_* WriteFunction for std::string
- * @param data The recv'd bytes
- * @param chunkSize Size per chunk
- * @param numChunks Number of chunks recv'd
- * @param str Pointer to string buffer
- * @return Total size of bytes recv'd
- */
-static size_t curl_easy_writefn_str(void *data, size_t chunkSize, size_t numChunks, std::string *str);
-
-/**
- * Send a POST request to a URL
- * @param apiUrl URL to send a request to
- * @param postData The POST data (format "key=value&key1=value1...")
- * @return std::pair<bool, std::string>{success, message}
- */
-APIResult MakeAPICall(std::string&& apiUrl, std::string&& postData);
-
 /* Custom GUI implementation */
 
 class CountButton {
@@ -114,164 +177,420 @@ private:
     }
 };
 
-/* Conversions */
+/* Application Details */
 
 /**
- * Convert seconds to HHMMSS format
- * @param seconds Seconds
- * @return String in HHMMSS format
+ * Endpoint a pending API call was made to, used to route its response
  */
-std::string SecondsToHMS(uint64_t seconds);
+enum class APIRequest {
+    Login,
+    Register,
+    Account,
+    Count,
+    New,
+    Delete,
+    Sessions,
+    Changes,
+    Stream
+};
+
+struct PendingCall {
+    APIRequest request;
+};
+
+/**
+ * Scroll position and filter of the project picker
+ */
+struct PickerState {
+    Vector2 scroll{};       // TODO: Reset value upon option selection
+    Rectangle view{};       // TODO: Reset value upon option selection
+    char filter[128]{};
+    bool filterEdit{};
+    std::string filterQuery{};      // filter the visible rows answer
+    uint64_t filterRevision = UINT64_MAX;   // tracks.revision() they answer
+    std::vector<uint32_t> visible{};
+};
 
-/* Application Details */
 struct ApplicationDetails {
-    APIResult apicall;
+    std::unordered_map<uint64_t, PendingCall> apicalls{};
     AuthToken auth{};
     std::string trackName{};
     uint64_t sessionSeconds{}, savedSeconds{};
     std::chrono::time_point<std::chrono::system_clock> start{};
     bool promptedClose{}, shouldClose{}, promptedLogout{}, tracksCached{};
     std::tuple<bool, std::string, std::chrono::time_point<std::chrono::system_clock>> lastMessage{};
-    std::vector<std::string> trackNames{};
+    TrackTable tracks{};
+    PickerState picker{};
+    CachedAccount account{};    // owner of tracks, mirrored to the cache file
+    std::string cachePath{};
+    bool cacheDirty{};
+    std::chrono::time_point<std::chrono::steady_clock> nextCacheSave{};    // dirty caches wait for it
+    SessionJournal journal{};
+    std::chrono::time_point<std::chrono::steady_clock> nextUpload{};    // of journaled intervals
+    ResponseDecoder decoder{};  // for responses the network worker did not decode, reused
+    SnapshotBuilder snapshots{WakeRenderLoop};
+    uint64_t accountBuild{};    // snapshot that will replace tracks, 0 if none
+    uint64_t streamId{};        // open change stream, 0 if none
+    std::chrono::time_point<std::chrono::steady_clock> streamRetry{};
+    LatencyStats latency{};     // of every completed call, see DrawLatencyOverlay()
+    bool showLatency{}, showProfiler{};
+    APIScope api{};             // running API tasks, last so they go before the state they use
 };
 
+/**
+ * @param request Kind of request
+ * @return Endpoint it is sent to, e.g. "/login"
+ */
+const char* APIEndpoint(APIRequest request);
+
+/**
+ * Send an API call and add it to the request table
+ * @param details Application details holding the request table
+ * @param request Kind of request, selects the response handler
+ * @param apiUrl URL to send a request to
+ * @param postData The POST data (format "key=value&key1=value1...")
+ * @return Request id keying the request table
+ */
+uint64_t SubmitAPICall(ApplicationDetails& details, APIRequest request, std::string&& apiUrl, std::string&& postData);
+
+/**
+ * Form body of the calls about one track (/count, /new, /delete)
+ * @param track Track name
+ * @param userid Owner of the track
+ * @return Encoded form
+ */
+std::string TrackForm(std::string_view track, uint64_t userid);
+
+/**
+ * Send a GET API call and add it to the request table
+ * @param details Application details holding the request table
+ * @param request Kind of request, selects the response handler
+ * @param apiUrl URL to send a request to, including the query string
+ * @param ifNoneMatch ETag of the copy we hold (may be empty)
+ * @return Request id keying the request table
+ */
+uint64_t SubmitAPIGet(ApplicationDetails& details, APIRequest request, std::string&& apiUrl, std::string&& ifNoneMatch);
+
+/**
+ * Check if a kind of request is still in flight
+ * @param details Application details holding the request table
+ * @param request Kind of request
+ * @return Boolean for whether a matching request is pending
+ */
+bool IsAPICallPending(const ApplicationDetails& details, APIRequest request);
+
+/**
+ * Abort the requests of the session or track being left and forget them, so no late answer applies
+ * @param details Application details holding the request table
+ * @param session Boolean for whether the whole session ends, otherwise only the selected track changes
+ */
+void CancelAPICalls(ApplicationDetails& details, bool session);
+
+/**
+ * Send an API call for a task to co_await, it goes through the request table like any other
+ * @param details Application details holding the request table
+ * @param request Kind of request, selects the response handler
+ * @param apiUrl URL to send a request to
+ * @param postData The POST data (format "key=value&key1=value1...")
+ * @return Awaitable for the response, HandleAPIResponse() has applied it by the time the task resumes
+ */
+APIFuture AwaitAPICall(ApplicationDetails& details, APIRequest request, std::string&& apiUrl, std::string&& postData);
+
+/**
+ * Sign in, creating the account first if asked to, then bring the track list up to date
+ * @param details Application details
+ * @param registering Boolean for whether to register before logging in
+ * @param user Username as typed
+ * @param pass Password as typed
+ */
+APITask SignIn(ApplicationDetails& details, bool registering, std::string user, std::string pass);
+
+/**
+ * Apply a completed API call to the application state
+ * @param details Application details
+ * @param request Kind of request that completed
+ * @param data {id, success, message} from the network worker
+ */
+void HandleAPIResponse(ApplicationDetails& details, APIRequest request, APIResponse& data);
+
+/**
+ * Bring the track list up to date: the changes since our copy if we have one, the whole account otherwise
+ * @param details Application details
+ * @return Awaitable for the response, may be dropped
+ */
+APIFuture RefreshTracks(ApplicationDetails& details);
+
+/**
+ * Forget the version of our copy and fetch the whole account, for when the copy matches no server version
+ * @param details Application details
+ */
+void ReloadAccount(ApplicationDetails& details);
+
+/**
+ * Start replacing the track list with the one in an /account response
+ * The table is built by details.snapshots and swapped in by AdoptSnapshot()
+ * @param details Application details
+ * @param account The decoded response
+ * @param etag Version stamp of the response, empty if the server sent none
+ */
+void ApplyAccount(ApplicationDetails& details, std::unique_ptr<Response> account, const std::string& etag);
+
+/**
+ * Swap in a finished track list, if it is still the one we wait for
+ * @param details Application details
+ * @param snapshot The snapshot, handed back to details.snapshots afterwards
+ */
+void AdoptSnapshot(ApplicationDetails& details, std::unique_ptr<TrackSnapshot> snapshot);
+
+/**
+ * Apply a CHANGES payload (from /changes or the change stream) to the track list
+ * @param details Application details
+ * @param changes The decoded payload
+ * @param etag Version stamp of the state after the changes, empty to take the one in the payload
+ */
+void ApplyTrackChanges(ApplicationDetails& details, const Response& changes, const std::string& etag);
+
+/**
+ * Handle an event from the change stream, or its end
+ * @param details Application details
+ * @param data The event (partial) or the end of the stream
+ */
+void HandleStreamEvent(ApplicationDetails& details, APIResponse& data);
+
+/**
+ * Record the interval counted since details.start in the journal
+ * @param details Application details
+ * @param end When counting stopped
+ * @return Seconds in the interval
+ */
+uint64_t JournalInterval(ApplicationDetails& details, std::chrono::time_point<std::chrono::system_clock> end);
+
+/**
+ * Send the next batch of released journal intervals
+ * @param details Application details
+ */
+void UploadJournal(ApplicationDetails& details);
+
+/**
+ * Encode the account and its tracks and queue the cache file write on the snapshot worker
+ * @param details Application details
+ */
+void StoreAccountCache(ApplicationDetails& details);
+
+/**
+ * Earliest point in time at which the loop has background work to do, for on-demand rendering
+ * @param details Application details
+ * @return The deadline, std::nullopt if nothing waits for one
+ */
+std::optional<std::chrono::time_point<std::chrono::steady_clock>> NextDeadline(const ApplicationDetails& details);
+
 /* Other pages */
 
 /**
  * Draw the login screen
- * @param apicall The APIResult to handle login / register
+ * @param details Application details to send login / register with
  */
-void DrawLogin(APIResult * apicall);
+void DrawLogin(ApplicationDetails& details);
 
 /**
  * Draw the project picker screen
  */
 void DrawProjectPicker(ApplicationDetails& details);
 
+/**
+ * Draw the last message until it is 5 seconds old, then clear it
+ * @param details Application details holding the message
+ * @param x Left edge, or the center if centered
+ * @param y Top edge
+ * @param centered Boolean for whether x is the center
+ */
+void DrawLastMessage(ApplicationDetails& details, int x, int y, bool centered);
+
+/**
+ * Draw the login page: the form, the last message and the server address
+ * @param details Application details
+ */
+void DrawLoginPage(ApplicationDetails& details);
+
+/**
+ * Draw the track selection page: the picker and the last message
+ * @param details Application details
+ */
+void DrawPickerPage(ApplicationDetails& details);
+
+/**
+ * Draw the counting page of the selected track and handle its buttons
+ * @param details Application details
+ * @param countButton The start / stop button
+ */
+void DrawTrackPage(ApplicationDetails& details, CountButton& countButton);
+
+/**
+ * Draw the request latency table over the page (toggled with F3)
+ * Median and 99th percentile per endpoint and phase, in milliseconds
+ * @param latency Latency statistics
+ */
+void DrawLatencyOverlay(const LatencyStats& latency);
+
+#ifdef TIMETRACKER_PROFILING
+/**
+ * Draw the frame time graph and the zone times of the profiler (toggled with F4)
+ * @param budget Frame time budget, frames over it are drawn red
+ */
+void DrawProfilerOverlay(std::chrono::nanoseconds budget);
+#endif
+
+/**
+ * Draw every page headless, against synthetic state and scripted input, and report the cost per frame
+ * Frames go to a render texture of a hidden window, so it runs under Xvfb with Mesa's software GL, e.g.
+ *   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run -a ./TimeTracker --bench-ui=ui.json
+ * @param reportPath Where to write the JSON report, empty to only print the table
+ * @return Exit code
+ */
+int RunUIBenchmark(const std::string& reportPath);
+
 /* Entry point */
 
 int main(int argc, char** argv) {
+    // On-demand rendering only redraws on input, network responses and clock ticks
+    // --continuous redraws every frame instead
+    // --trace[=path] records a timeline of frames and requests, written on exit (see TracePath())
+    // --bench-ui[=path] only runs the UI benchmark (see RunUIBenchmark())
+    bool onDemand = true;
+    std::string tracePath{};
+    std::optional<std::string> benchPath{};
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--continuous") == 0) onDemand = false;
+        else if(strcmp(argv[i], "--trace") == 0) tracePath = TracePath();
+        else if(strncmp(argv[i], "--trace=", 8) == 0) tracePath = argv[i] + 8;
+        else if(strcmp(argv[i], "--bench-ui") == 0) benchPath = std::string();
+        else if(strncmp(argv[i], "--bench-ui=", 11) == 0) benchPath = argv[i] + 11;
+    }
+    if(benchPath) return RunUIBenchmark(*benchPath);
+    if(!tracePath.empty()) {
+        TraceThreadName("render");
+        StartTrace(tracePath);
+    }
+#ifndef TIMETRACKER_GLFW_WAKEUP
+    onDemand = false; // nothing could wake the loop for responses or ticks
+#endif
+
     InitWindow(600, 800, DEFAULT_WIN_TITLE);
-    SetTargetFPS(30);
+    constexpr int targetFPS = 30;
+    SetTargetFPS(targetFPS);
+    if(onDemand) EnableEventWaiting();
 
     curl_global_init(CURL_GLOBAL_DEFAULT);
+    InitAPI(WakeRenderLoop);
 
     GuiLoadStyleCyber();
 
     ApplicationDetails appDetails{};
     appDetails.start = std::chrono::system_clock::now();
 
-    APIResult& apicall = appDetails.apicall;
+    auto& apicalls = appDetails.apicalls;
     AuthToken& auth = appDetails.auth;
     std::string& trackName = appDetails.trackName;
-    uint64_t& sessionSeconds = appDetails.sessionSeconds, &savedSeconds = appDetails.savedSeconds;
+    uint64_t& sessionSeconds = appDetails.sessionSeconds;
     std::chrono::time_point<std::chrono::system_clock>& start = appDetails.start;
     bool& promptedClose = appDetails.promptedClose, &shouldClose = appDetails.shouldClose, &promptedLogout = appDetails.promptedLogout, &tracksCached = appDetails.tracksCached;
     std::tuple<bool, std::string, std::chrono::time_point<std::chrono::system_clock>>& lastMessage = appDetails.lastMessage;
-    std::vector<std::string>& trackNames = appDetails.trackNames;
-
-    auto apicall_isReady = [&apicall]() {
-        return apicall.valid() && apicall.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
-    };
+    TrackTable& tracks = appDetails.tracks;
+
+    // Stale-while-revalidate: restore the last session from disk, the picker renders from it
+    // right away and the /account call it sends on the first frame brings it up to date
+    appDetails.cachePath = AccountCachePath();
+    if(LoadAccountCache(appDetails.cachePath, appDetails.account, tracks) && appDetails.account.signedIn) {
+        auth.userid = appDetails.account.userid;
+        auth.username = appDetails.account.username;
+        auth.token = "cached"; // NOTICE: TEMPORARY, like the login token
+        std::string newWinTitle = "(" + auth.username + ") Time Tracker";
+        SetWindowTitle(newWinTitle.c_str());
+    }
 
-    auto time_expired = [](std::chrono::time_point<std::chrono::system_clock>& tp, uint64_t duration) {
-        if(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now() - tp).count() > duration) {
-            return true;
-        } else return false;
-    };
+    // Counted time goes to the journal first, so it survives a closed app or an unreachable server
+    if(!appDetails.journal.open(JournalPath()))
+        fprintf(stderr, "Could not open the session journal, counted time is only kept in memory\n");
 
     CountButton CountButton;
     Color backgroundColor = RGBToColor(41U, 44U, 51U);
 
-
+    RenderTicker ticker;
+    std::optional<std::chrono::time_point<std::chrono::steady_clock>> lastWarmUp{};
+    uint64_t framesDrawn = 0;
+    auto firstFrame = std::chrono::steady_clock::now();
+    uint64_t frameTraceStart = 0;
+
+    // Finish the frame. In on-demand mode EndDrawing() blocks until input or a wake-up,
+    // so keep the ticker running while the clock or a message is on screen
+    auto endFrame = [&]() {
+        if(onDemand) {
+            if(!auth.token.empty() && !trackName.empty() && CountButton.isCounting()) ticker.tick(start);
+            else if(!std::get<1>(lastMessage).empty()) ticker.tick(std::get<2>(lastMessage));
+            else ticker.tick(std::nullopt);
+            ticker.wakeAt(NextDeadline(appDetails));
+        }
+        if(appDetails.showLatency) DrawLatencyOverlay(appDetails.latency);
+#ifdef TIMETRACKER_PROFILING
+        if(appDetails.showProfiler) DrawProfilerOverlay(std::chrono::nanoseconds(1000000000 / targetFPS));
+#endif
+        PROFILE_END_FRAME(); // EndDrawing() may wait for input, that is not frame time
+        if(frameTraceStart != 0U) TraceComplete("frame", frameTraceStart);
+        EndDrawing();
+        framesDrawn++;
+    };
 
     while(!shouldClose) {
+        PROFILE_BEGIN_FRAME();
+        frameTraceStart = TraceEnabled() ? TraceNow() : 0U;
         if(WindowShouldClose()) promptedClose = true;
+        if(IsKeyPressed(KEY_F3)) appDetails.showLatency = !appDetails.showLatency;
+#ifdef TIMETRACKER_PROFILING
+        if(IsKeyPressed(KEY_F4)) appDetails.showProfiler = !appDetails.showProfiler;
+#endif
 
-        if(apicall_isReady()) {
-            // Handle API response data
-            auto data = apicall.get();
-            std::cout << "API Call: " << (data.first ? "Success" : "Error") << std::endl;
-            std::cout << "API Result: " << data.second << std::endl;
-            lastMessage = {data.first, data.second, std::chrono::system_clock::now()};
-
-            try {
-                Json::Reader reader;
-                Json::Value root;
-                if (!reader.parse(data.second, root)) {
-                    // A parsing error has occurred
-                    data.first = false;
-                    data.second = reader.getFormattedErrorMessages();
-                } else {
-                    // Parse was successful
-                    if (root.isMember("error")) {
-                        // An API error has occurred
-                        std::get<0>(lastMessage) = false;
-                        std::get<1>(lastMessage) = root["error"].asString();
-                    } else if (root.isMember("behavior")) {
-                        // Expected API behavior
-                        std::get<0>(lastMessage) = true;
-                        std::string behavior = root["behavior"].asString();
-                        std::get<1>(lastMessage) = root.isMember("message") ? root["message"].asString()
-                                                                            : std::string();
-                        if (behavior == "VERSION") {
-                            // VERSION DETAILS
-                            if (root.isMember("name")) printf("Application Name: %s\n", root["name"].asCString());
-                            if (root.isMember("description"))
-                                printf("Application Name: %s\n", root["description"].asCString());
-                            if (root.isMember("version")) printf("Application Name: %s\n", root["version"].asCString());
-                        } else if (behavior == "AUTHENTICATION") {
-                            // LOG IN
-                            if (!root.isMember("username") || !root.isMember("uid")) {
-                                // Malformed
-                                std::get<0>(lastMessage) = false;
-                                std::get<1>(lastMessage) = "Bad auth.";
-                            } else {
-                                // Successful
-                                std::string newWinTitle = "(" + root["username"].asString() + ") Time Tracker";
-                                SetWindowTitle(newWinTitle.c_str());
-                                auth.username = root["name"].asString();
-                                auth.userid = root["uid"].asUInt64();
-                                auth.token = "filled"; // NOTICE: TEMPORARY
-                                continue;
-                            }
-                        } else if (behavior == "ACCOUNT") {
-                            // ACCOUNT DETAILS
-                            Json::StreamWriterBuilder writeBuilder;
-                            std::string details = Json::writeString(writeBuilder, root);
-
-                            printf("Account details: %s\n", details.c_str());
-
-                            if (root.isMember("tracks") && root["tracks"].isArray()) {
-                                for (Json::Value::ArrayIndex i = 0; i != root["tracks"].size(); i++) {
-                                    if (root["tracks"][i].isMember("track"))
-                                        trackNames.push_back(root["tracks"][i]["track"].asString());
-                                }
-                            }
-                        } else if (behavior == "SAVEACK") {
-                            // Saved successfully!
-                            savedSeconds += sessionSeconds;
-                            sessionSeconds = 0U;
-                            continue;
-                        } else if (behavior == "TRACKINFO") {
-                            // Track update
-                            if (root.isMember("seconds")) {
-                                savedSeconds = root["seconds"].asUInt64();
-                                std::get<1>(lastMessage) = "Synced successfully!";
-                            }
-                        }
-                    } else if (root.isMember("message")) {
-                        std::get<0>(lastMessage) = true;
-                        std::get<1>(lastMessage) = root["message"].asString();
-                    } else {
-                        std::get<0>(lastMessage) = false;
-                        std::get<1>(lastMessage) = "Unknown request. See stderr for details.";
-                        fprintf(stderr, "Unknown response: %s\n", root.asCString());
-                    }
-                }
-            } catch(const std::exception& e) {
-                fprintf(stderr, "JsonCpp error: %s\n", e.what());
+        // Handle API response data pushed by the network worker since the last frame
+        {
+            PROFILE_ZONE("responses");
+            for(APIResponse response; PollAPI(response);) {
+                auto call = apicalls.find(response.id);
+                if(call == apicalls.end()) continue; // no longer tracked, e.g. cancelled by a logout
+
+                APIRequest request = call->second.request;
+                uint64_t handleStart = TraceEnabled() ? TraceNow() : 0U;
+                if(!response.partial) apicalls.erase(call);
+                if(request == APIRequest::Stream) HandleStreamEvent(appDetails, response);
+                else HandleAPIResponse(appDetails, request, response);
+                if(!response.partial && request != APIRequest::Stream) appDetails.latency.record(APIEndpoint(request), response.timing);
+                appDetails.api.deliver(response); // resume the task waiting for it, if any
+                if(handleStart != 0U) TraceComplete("response", handleStart, APIEndpoint(request));
             }
+            for(std::unique_ptr<TrackSnapshot> snapshot; appDetails.snapshots.poll(snapshot);)
+                AdoptSnapshot(appDetails, std::move(snapshot));
+            // Changes come in bursts, one save covers all of them
+            if(appDetails.cacheDirty && std::chrono::steady_clock::now() >= appDetails.nextCacheSave) StoreAccountCache(appDetails);
+        }
+
+        // Keep a change stream open while signed in, so edits made elsewhere show up without polling.
+        // It starts from the revision of our copy, which the first refresh provides
+        if(!auth.token.empty() && appDetails.streamId == 0U && appDetails.account.userid == auth.userid &&
+           appDetails.account.seq > 0U && std::chrono::steady_clock::now() >= appDetails.streamRetry) {
+            appDetails.streamId = OpenAPIStream("/stream?uid=" + std::to_string(auth.userid) + "&since=" + std::to_string(appDetails.account.seq));
+            apicalls.emplace(appDetails.streamId, PendingCall {APIRequest::Stream});
+        }
+
+        // Upload journaled intervals in the background, one batch at a time
+        if(!auth.token.empty() && !IsAPICallPending(appDetails, APIRequest::Sessions) && std::chrono::steady_clock::now() >= appDetails.nextUpload)
+            UploadJournal(appDetails);
+
+        // Nothing to see while minimized, only keep handling events
+        if(IsWindowMinimized() && !promptedClose) {
+            if(onDemand) {
+                ticker.tick(std::nullopt);
+                ticker.wakeAt(NextDeadline(appDetails));
+            } else WaitTime(1.0 / 30.0);
+            PollInputEvents(); // blocks until the next event in on-demand mode
+            continue;
         }
 
         BeginDrawing();
@@ -280,16 +599,16 @@ int main(int argc, char** argv) {
         // Draw the login screen
         if(auth.token.empty()) {
             if(promptedClose) shouldClose = true;
-            DrawLogin(&apicall);
-            const int fontSize = 14;
-            // Draw the lastMessage
-            if(!std::get<1>(lastMessage).empty())
-                if(!time_expired(std::get<2>(lastMessage), 5ULL)) {
-                    DrawText(std::get<1>(lastMessage).c_str(), 300 - (MeasureText(std::get<1>(lastMessage).c_str(), fontSize) / 2), 450, fontSize, std::get<0>(lastMessage) ? WHITE : RED);
-                } else lastMessage = {};
-            std::string serverMessage = "Server: " + std::string(BASE_API_URL);
-            DrawText(serverMessage.c_str(), 300 - (MeasureText(serverMessage.c_str(), fontSize) / 2), 455 + fontSize, fontSize, WHITE);
-            EndDrawing();
+
+            // Keep a connection open while the user types (the server holds idle ones for 60s),
+            // so Log in costs one round trip instead of DNS and handshakes first
+            if(auto now = std::chrono::steady_clock::now(); !lastWarmUp || now - *lastWarmUp > std::chrono::seconds(50)) {
+                WarmUpAPI();
+                lastWarmUp = now;
+            }
+
+            DrawLoginPage(appDetails);
+            endFrame();
             continue;
         }
 
@@ -298,25 +617,19 @@ int main(int argc, char** argv) {
             if(promptedClose) shouldClose = true;
 
             if(!tracksCached) {
-                trackNames.clear();
-                apicall = MakeAPICall("/account", "uid=" + std::to_string(auth.userid));
+                // Keep showing the tracks we have while they are brought up to date
+                RefreshTracks(appDetails);
                 tracksCached = true;
             }
-            DrawProjectPicker(appDetails);
-            // Draw the lastMessage
-            const int fontSize = 14;
-            if(!std::get<1>(lastMessage).empty())
-                if(!time_expired(std::get<2>(lastMessage), 5ULL)) {
-                    DrawText(std::get<1>(lastMessage).c_str(), 300 - (MeasureText(std::get<1>(lastMessage).c_str(), fontSize) / 2), 450, fontSize, std::get<0>(lastMessage) ? WHITE : RED);
-                } else lastMessage = {};
-            EndDrawing();
+            DrawPickerPage(appDetails);
+            endFrame();
             continue;
         }
         tracksCached = false;
 
         // Draw the on-exit dialog box
         if(promptedClose) {
-            switch(GuiMessageBox(Rectangle {200.f, 250.f, 200.f, 200.f}, "Confirmation Dialogue", "You sure you want to exit?\nYour time may not be saved.", "Yes;No")) {
+            switch(GuiMessageBox(Rectangle {200.f, 250.f, 200.f, 200.f}, "Confirmation Dialogue", "You sure you want to exit?\nUnsaved time is uploaded\nthe next time you sign in.", "Yes;No")) {
                 case 1:
                     shouldClose = true;
                     break;
@@ -326,14 +639,14 @@ int main(int argc, char** argv) {
                     break;
             }
 
-            EndDrawing();
+            endFrame();
             continue;
         } else if(promptedLogout) {
             // Draw the on-logout dialog box
             bool shouldLogout = false;
 
             if(sessionSeconds > 0U)
-                switch(GuiMessageBox(Rectangle {200.f, 250.f, 200.f, 200.f}, "Confirmation Dialogue", "You sure you want to logout?\nYour time may not be saved.", "Yes;No")) {
+                switch(GuiMessageBox(Rectangle {200.f, 250.f, 200.f, 200.f}, "Confirmation Dialogue", "You sure you want to logout?\nUnsaved time is uploaded\nthe next time you sign in.", "Yes;No")) {
                     case 1:
                         shouldLogout = true;
                         break;
@@ -345,8 +658,22 @@ int main(int argc, char** argv) {
             else shouldLogout = true;
 
             if(shouldLogout) {
+                // Keep the tracks on disk for the next login, but do not sign in with them
+                appDetails.account.signedIn = false;
+                StoreAccountCache(appDetails);
+
+                // Hand unsaved time to the uploader
+                if(CountButton.isCounting()) {
+                    JournalInterval(appDetails, std::chrono::system_clock::now());
+                    CountButton.toggleCounting();
+                }
+                appDetails.journal.releaseAll(auth.userid);
+
+                // Nothing sent for this session may land in the next one
+                TraceInstant("logout");
+                CancelAPICalls(appDetails, true);
+
                 sessionSeconds = 0U;
-                CountButton.isCounting() ? CountButton.toggleCounting() : void();
                 auth = {};
                 SetWindowTitle(DEFAULT_WIN_TITLE);
                 promptedLogout = false;
@@ -354,143 +681,547 @@ int main(int argc, char** argv) {
                 tracksCached = false;
             }
 
-            EndDrawing();
+            endFrame();
             continue;
         }
 
-        // Determine counting state and draw the button
-        bool wasCounting = CountButton.isCounting();
-        if(CountButton.draw(300, 400, 220)) {
-            CountButton.toggleCounting();
-            if(!wasCounting) start = std::chrono::system_clock::now();
+        DrawTrackPage(appDetails, CountButton);
+        endFrame();
+    }
+
+#ifndef NDEBUG
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - firstFrame).count();
+    printf("Rendered %llu frames in %.1fs (%.2f fps, %s)\n", static_cast<unsigned long long>(framesDrawn), elapsed,
+           elapsed > 0.0 ? framesDrawn / elapsed : 0.0, onDemand ? "on-demand" : "continuous");
+#endif
+
+    if(appDetails.cacheDirty) StoreAccountCache(appDetails);
+    if(!appDetails.latency.endpoints().empty()) {
+        std::string latencyPath = LatencyReportPath();
+        if(appDetails.latency.dump(latencyPath)) printf("Request latency written to %s\n", latencyPath.c_str());
+    }
+
+    // Keep whatever is still being counted
+    if(!auth.token.empty() && !trackName.empty() && CountButton.isCounting())
+        JournalInterval(appDetails, std::chrono::system_clock::now());
+    appDetails.journal.close();
+
+    CloseAPI();
+    curl_global_cleanup();
+    appDetails.snapshots.stop();
+
+    // The workers are stopped, nothing records into the trace anymore
+    if(StopTrace()) printf("Trace written to %s\n", tracePath.c_str());
+
+    CloseWindow();
+
+    return 0;
+}
+
+/* Method definitions */
+
+uint64_t SubmitAPICall(ApplicationDetails& details, APIRequest request, std::string&& apiUrl, std::string&& postData) {
+    uint64_t id = MakeAPICall(std::move(apiUrl), std::move(postData));
+    details.apicalls.emplace(id, PendingCall {request});
+    return id;
+}
+
+std::string TrackForm(std::string_view track, uint64_t userid) {
+    std::string form;
+    AppendFormField(form, "track", track);
+    form += "&uid=" + std::to_string(userid);
+    return form;
+}
+
+uint64_t SubmitAPIGet(ApplicationDetails& details, APIRequest request, std::string&& apiUrl, std::string&& ifNoneMatch) {
+    uint64_t id = MakeAPIGet(std::move(apiUrl), std::move(ifNoneMatch));
+    details.apicalls.emplace(id, PendingCall {request});
+    return id;
+}
+
+const char* APIEndpoint(APIRequest request) {
+    switch(request) {
+        case APIRequest::Login: return "/login";
+        case APIRequest::Register: return "/register";
+        case APIRequest::Account: return "/account";
+        case APIRequest::Count: return "/count";
+        case APIRequest::New: return "/new";
+        case APIRequest::Delete: return "/delete";
+        case APIRequest::Sessions: return "/sessions";
+        case APIRequest::Changes: return "/changes";
+        case APIRequest::Stream: return "/stream";
+        default: return "/unknown";
+    }
+}
+
+bool IsAPICallPending(const ApplicationDetails& details, APIRequest request) {
+    return std::any_of(details.apicalls.begin(), details.apicalls.end(), [request](const auto& call) {
+        return call.second.request == request;
+    });
+}
+
+void CancelAPICalls(ApplicationDetails& details, bool session) {
+    // Tasks first, the calls they wait for go with the rest
+    if(session) {
+        details.api.cancel();
+        details.streamId = 0U;
+        details.accountBuild = 0U;
+    }
+
+    for(auto it = details.apicalls.begin(); it != details.apicalls.end();) {
+        // Only a sync answer is about the selected track, the others hold for the whole session
+        if(!session && it->second.request != APIRequest::Count) {
+            ++it;
+            continue;
         }
-        bool isCounting = CountButton.isCounting();
-
-        // Get the # of sessionSeconds passed since counting
-        uint32_t uncountedSeconds = CountButton.isCounting() ? std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now() - start).count() : 0U;
-
-        // Draw the current counting time OR save the duration to sessionSeconds
-        if(isCounting) {
-            std::string hmsStr = SecondsToHMS(uncountedSeconds);
-            DrawText(hmsStr.c_str(), 300 - (MeasureText(hmsStr.c_str(), 36) / 2), 700, 36, WHITE);
-        } else if(wasCounting && !isCounting) {
-            // Add duration
-            std::chrono::time_point end = std::chrono::system_clock::now();
-            sessionSeconds += std::chrono::duration_cast<std::chrono::seconds>(end - start).count();
+        CancelAPICall(it->first);
+        it = details.apicalls.erase(it);
+    }
+}
+
+APIFuture AwaitAPICall(ApplicationDetails& details, APIRequest request, std::string&& apiUrl, std::string&& postData) {
+    return details.api.await(SubmitAPICall(details, request, std::move(apiUrl), std::move(postData)));
+}
+
+APITask SignIn(ApplicationDetails& details, bool registering, std::string user, std::string pass) {
+    std::string credentials;
+    AppendFormField(credentials, "username", user);
+    AppendFormField(credentials, "password", pass);
+
+    if(registering) {
+        APIResponse created = co_await AwaitAPICall(details, APIRequest::Register, "/register", std::string(credentials));
+        // Decided from this answer, lastMessage may already hold another response's. Errors were already shown
+        if(!created.success || !details.decoder.decode(created.body) || details.decoder.response().hasError) co_return;
+    }
+
+    co_await AwaitAPICall(details, APIRequest::Login, "/login", std::move(credentials));
+    if(details.auth.token.empty()) co_return;
+
+    // The picker needs the tracks next, ask for them now rather than when it first draws.
+    // Waiting here lets a logout in the meantime drop the answer
+    details.tracksCached = true;
+    co_await RefreshTracks(details);
+}
+
+void HandleAPIResponse(ApplicationDetails& details, APIRequest request, APIResponse& data) {
+    AuthToken& auth = details.auth;
+    uint64_t& savedSeconds = details.savedSeconds;
+    bool& tracksCached = details.tracksCached;
+    std::tuple<bool, std::string, std::chrono::time_point<std::chrono::system_clock>>& lastMessage = details.lastMessage;
+    TrackTable& tracks = details.tracks;
+
+    // Any answer means the server is reachable again, so retry journal uploads right away
+    if(data.success) details.nextUpload = {};
+    else if(request == APIRequest::Sessions) details.nextUpload = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+
+    // A delete the server did not take leaves our copy out of step with every server version
+    if(!data.success && request == APIRequest::Delete) ReloadAccount(details);
+
+    // The tracks we hold are current, nothing to parse
+    if(request == APIRequest::Account && data.success && data.status == 304) {
+        printf("Account unchanged (%s)\n", data.etag.c_str());
+        return;
+    }
+
+    std::cout << "API Call: " << (data.success ? "Success" : "Error") << std::endl;
+    if(!data.decoded) std::cout << "API Result: " << data.body << std::endl;
+
+    // Responses decoded on the network worker come ready, the rest is decoded here into reused buffers
+    Response* decoded = data.decoded.get();
+    if(!decoded) {
+        auto parseStart = std::chrono::steady_clock::now();
+        bool parsed;
+        {
+            TraceScope trace("parse");
+            parsed = details.decoder.decode(data.body);
+        }
+        data.timing.parse += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - parseStart).count();
+        if(!parsed) {
+            // Not JSON: a transfer error message, or a broken response
+            if(data.success) fprintf(stderr, "Bad response: %s\n", details.decoder.error().c_str());
+            lastMessage = {data.success, data.body, std::chrono::system_clock::now()};
+            return;
         }
+        decoded = &details.decoder.response();
+    }
+    Response& response = *decoded;
+    std::get<2>(lastMessage) = std::chrono::system_clock::now();
+
+    if(response.hasError) {
+        // An API error has occurred
+        std::get<0>(lastMessage) = false;
+        std::get<1>(lastMessage).assign(response.error);
+        if(request == APIRequest::Sessions) details.nextUpload = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        if(request == APIRequest::Delete && data.success) ReloadAccount(details);
+        return;
+    }
 
-        // Draw the live state of the work log
-        DrawText("Total: ", 10, 5, 20, WHITE);
-        DrawText(std::to_string(savedSeconds + sessionSeconds + uncountedSeconds).c_str(), 120, 5, 20, WHITE);
-        DrawText("Session: ", 10, 35, 20, WHITE);
-        DrawText(SecondsToHMS(sessionSeconds + uncountedSeconds).c_str(), 120, 35, 20, WHITE);
-        DrawText("Track: ", 10, 65, 20, WHITE);
-        DrawText(trackName.c_str(), 120, 65, 20, WHITE);
+    if(response.behavior == Behavior::None) {
+        if(response.hasMessage) {
+            std::get<0>(lastMessage) = true;
+            std::get<1>(lastMessage).assign(response.message);
 
-        // Draw the Sync and Sync & Save and Reset buttons
-        // Lock both if awaiting API callback or lock Sync & Save if counting
-        if(apicall.valid()) GuiDisable();
-        if(GuiButton(Rectangle {10.f, 95.f, 85.f, 25.f}, "Sync")) {
-            // Sync with server
-            apicall = MakeAPICall("/count", "track=" + trackName + "&uid=" + std::to_string(auth.userid));
+            // The track list changed, pull it again
+            if(request == APIRequest::New) tracksCached = false;
+        } else {
+            std::get<0>(lastMessage) = false;
+            std::get<1>(lastMessage) = "Unknown request. See stderr for details.";
+            fprintf(stderr, "Unknown response: %s\n", data.body.c_str());
         }
-        if(isCounting || sessionSeconds == 0U) GuiDisable();
-        if(GuiButton(Rectangle {105.f, 95.f, 85.f, 25.f}, "Save")) {
-            // Sync and save with server
-            apicall = MakeAPICall("/update", "uid=" + std::to_string(auth.userid) + "&track=" + trackName + "&seconds=" + std::to_string(sessionSeconds));
+        return;
+    }
+
+    // Expected API behavior
+    std::get<0>(lastMessage) = true;
+    std::get<1>(lastMessage).assign(response.message);
+
+    switch(response.behavior) {
+        case Behavior::Version:
+            printf("Application Name: %s\n", response.name.c_str());
+            printf("Application Description: %s\n", response.description.c_str());
+            printf("Application Version: %s\n", response.version.c_str());
+            break;
+
+        case Behavior::Authentication: {
+            // LOG IN
+            if(response.username.empty() || !response.hasUserid) {
+                // Malformed
+                std::get<0>(lastMessage) = false;
+                std::get<1>(lastMessage) = "Bad auth.";
+                break;
+            }
+
+            std::string newWinTitle = "(" + response.username + ") Time Tracker";
+            SetWindowTitle(newWinTitle.c_str());
+            auth.username = response.username;
+            auth.userid = response.userid;
+            auth.token = "filled"; // NOTICE: TEMPORARY
+            TraceInstant("login");
+
+            // Cached tracks of someone else must not show up
+            if(details.account.userid != auth.userid) {
+                tracks.clear();
+                details.account = {auth.userid};
+                details.accountBuild = 0U;
+            }
+            details.account.username = auth.username;
+            details.account.signedIn = true;
+            details.cacheDirty = true;
+            break;
         }
-        // Draw the Reset button
-        if(GuiButton(Rectangle {295.f, 95.f, 85.f, 25.f}, "Reset")) {
-            // Reset session count
-            sessionSeconds = 0U;
+
+        case Behavior::Account:
+            // Hand the response over, it is not used here after this
+            ApplyAccount(details, data.decoded ? std::move(data.decoded) : std::make_unique<Response>(response), data.etag);
+            break;
+
+        case Behavior::Changes:
+            // Deltas since our copy, applied in place
+            if(response.reset) {
+                // Too far behind, start over from the whole account
+                ReloadAccount(details);
+            } else ApplyTrackChanges(details, response, data.etag);
+            break;
+
+        case Behavior::SessionAck: {
+            // Journaled intervals reached the server, forget them and take the new totals
+            details.journal.acknowledge(response.ids);
+
+            // The rest are for tracks the server does not have, set them aside so later intervals
+            // still upload. They go out again once their track shows up, or are dropped with it
+            if(!response.failed.empty()) {
+                details.journal.refuse(response.failed);
+                std::get<0>(lastMessage) = false;
+            }
+
+            auto now = std::chrono::system_clock::now();
+            for(const TrackEntry& track : response.tracks) {
+                auto id = tracks.find(track.name);
+                if(!id) continue;
+                tracks.setSeconds(*id, track.seconds, now);
+                if(id == tracks.find(details.trackName)) savedSeconds = track.seconds;
+                details.cacheDirty = true;
+            }
+            break;
         }
-        GuiEnable();
 
-        // Draw the Logout button
-        if(GuiButton(Rectangle {200.f, 95.f, 85.f, 25.f}, "Logout")) {
-            // Sign out of session
-            promptedLogout = true;
+        case Behavior::TrackInfo: {
+            // Track update
+            if(!response.hasSeconds) break;
+
+            const std::string& track = !response.track.empty() ? response.track : details.trackName;
+            auto id = tracks.find(track);
+            if(id) {
+                tracks.setSeconds(*id, response.seconds, std::chrono::system_clock::now());
+                details.cacheDirty = true;
+            }
+
+            // Only the selected track drives the counter (a late answer may be for another one)
+            if(track == details.trackName || (id && id == tracks.find(details.trackName))) {
+                savedSeconds = response.seconds;
+                std::get<1>(lastMessage) = "Synced successfully!";
+            }
+            break;
         }
 
-        // Draw the lastMessage
-        if(!std::get<1>(lastMessage).empty())
-            if(!time_expired(std::get<2>(lastMessage), 5ULL)) {
-                const int fontSize = 14;
-                DrawText(std::get<1>(lastMessage).c_str(), 395.f, 95.f + (fontSize / 2) + 1.f, fontSize, std::get<0>(lastMessage) ? WHITE : RED);
-            } else lastMessage = {};
+        default:
+            break;
+    }
+}
 
-        EndDrawing();
+void ApplyAccount(ApplicationDetails& details, std::unique_ptr<Response> account, const std::string& etag) {
+    printf("Account details: %s (%llu), %zu tracks, seq %llu\n", account->username.c_str(), static_cast<unsigned long long>(account->userid),
+           account->tracks.size(), static_cast<unsigned long long>(account->seq));
+
+    // The ETag is the version stamp (servers without one: a hash of the body),
+    // an unchanged list needs no rebuild
+    std::string stamp = etag;
+    if(stamp.empty()) {
+        char hash[17];
+        snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(account->bodyHash));
+        stamp = hash;
     }
+    if(!account->hasTracks || (stamp == details.account.stamp && details.tracks.size() > 0)) return;
 
-    curl_global_cleanup();
+    // Overlapping refreshes each deliver the full list, the last one wins
+    details.accountBuild = details.snapshots.build(details.account, std::move(stamp), std::move(account), details.cachePath);
+}
 
-    CloseWindow();
+void AdoptSnapshot(ApplicationDetails& details, std::unique_ptr<TrackSnapshot> snapshot) {
+    if(snapshot->id == details.accountBuild && snapshot->userid == details.account.userid) {
+        // Changes applied while it was built may be newer than the snapshot, fetch them again on top
+        const bool behind = snapshot->seq < details.account.seq;
+
+        details.tracks.swap(snapshot->tracks);
+        TraceInstant("tracks swapped");
+        details.account.stamp = std::move(snapshot->stamp);
+        details.account.seq = snapshot->seq;
+        details.accountBuild = 0U; // the worker cached it already
+        if(behind) RefreshTracks(details);
+    }
 
-    return 0;
+    // Either way the table it holds now is of no use, let the worker free it
+    details.snapshots.retire(std::move(snapshot));
 }
 
-/* Method definitions */
+void ApplyTrackChanges(ApplicationDetails& details, const Response& changes, const std::string& etag) {
+    TrackTable& tracks = details.tracks;
+    uint64_t& have = details.account.seq;
+    if(have == 0U) return; // a full reload is on its way
+
+    auto now = std::chrono::system_clock::now();
+    for(const TrackChange& change : changes.changes) {
+        // The stream and /changes can overlap, skip what we already have. A gap means we missed some
+        if(change.seq <= have) continue;
+        if(change.seq > have + 1U) {
+            RefreshTracks(details);
+            return;
+        }
+        have = change.seq;
+
+        auto id = tracks.find(change.track);
+
+        // Our own edits come back too, so every kind tolerates already being applied
+        switch(change.kind) {
+            case ChangeKind::Insert:
+                if(!id) tracks.insert(change.track, change.seconds, now);
+                else tracks.setSeconds(*id, change.seconds, now);
+                details.journal.retry(details.account.userid, change.track);
+                details.nextUpload = {};
+                break;
+            case ChangeKind::Delete:
+                // Intervals of a deleted track can never be stored
+                details.journal.forget(details.account.userid, id ? std::string_view(tracks[*id].name) : std::string_view(change.track));
+                if(id) tracks.erase(*id);
+                break;
+            case ChangeKind::Rename:
+                // Intervals not uploaded yet would be refused under the old name
+                details.journal.rename(details.account.userid, id ? std::string_view(tracks[*id].name) : std::string_view(change.track), change.name);
+                if(id) {
+                    if(details.trackName == tracks[*id].name) details.trackName = change.name;
+                    tracks.rename(*id, change.name);
+                    tracks.setSeconds(*id, change.seconds, now);
+                }
+                break;
+            case ChangeKind::Seconds:
+                if(id) {
+                    tracks.setSeconds(*id, change.seconds, now);
+                    if(id == tracks.find(details.trackName)) details.savedSeconds = change.seconds;
+                }
+                break;
+            default:
+                break;
+        }
+    }
 
-static size_t curl_easy_writefn_str(void *data, size_t chunkSize, size_t numChunks, std::string *str) {
-    size_t totalSize = chunkSize * numChunks;
-    str->append(static_cast<char*>(data), totalSize);
-    return totalSize;
+    // Only ever move forward, a late /changes answer must not rewind what the stream applied
+    if(changes.seq >= have) {
+        have = changes.seq;
+        details.account.stamp = !etag.empty() ? etag : changes.etag;
+    }
+    details.cacheDirty = true;
 }
 
-APIResult MakeAPICall(std::string&& apiUrl, std::string&& postData) {
-    return std::async(std::launch::async, [](std::string&& _apiUrl, std::string&& _postData) -> std::pair<bool, std::string> {
-        CURL* curl = curl_easy_init();
-        if(curl == nullptr) throw std::runtime_error("Could not initialize CURL.");
-        CURLcode res;
+void HandleStreamEvent(ApplicationDetails& details, APIResponse& data) {
+    if(!data.partial) {
+        // The stream ended (server restart, network change, idle timeout), reopen it in a while
+        // and catch up on what was missed in between
+        printf("Change stream closed: %s\n", data.body.c_str());
+        details.streamId = 0U;
+        details.streamRetry = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        if(!details.auth.token.empty()) details.tracksCached = false;
+        return;
+    }
 
-        // general configuration
-        curl_easy_setopt(curl, CURLOPT_URL, _apiUrl.c_str());
-#ifdef BASE_API_PORT
-        curl_easy_setopt(curl, CURLOPT_PORT, BASE_API_PORT);
-#endif
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-
-        // receive data
-        std::string data;
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_easy_writefn_str);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &data);
-
-        // send data
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-//        curl_slist* headers = nullptr; // must be set to nullptr FIRST
-//        headers = curl_slist_append(headers, "Content-Type: application/json");
-//        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, _postData.c_str());
+    if(!details.decoder.decode(data.body) || details.decoder.response().behavior != Behavior::Changes) {
+        fprintf(stderr, "Unexpected stream event: %s\n", data.body.c_str());
+        return;
+    }
 
-#ifndef NDEBUG
-#ifdef BASE_API_PORT
-        printf("POST REQUEST: %s:%d%s\n", BASE_API_URL, BASE_API_PORT, _apiUrl.substr(strlen(BASE_API_URL)).c_str());
-#else
-        printf("POST REQUEST: %s\n", _apiUrl.c_str());
-#endif
-        printf("POST DATA: %s\n", _postData.c_str());
-        fflush(stdout);
-#endif
-        // send the request
-        res = curl_easy_perform(curl);
+    const Response& changes = details.decoder.response();
+    if(changes.reset) {
+        // Too far behind, start over from the whole account
+        details.account.seq = 0U;
+        details.account.stamp.clear();
+        RefreshTracks(details);
+    } else ApplyTrackChanges(details, changes, std::string());
+}
+
+APIFuture RefreshTracks(ApplicationDetails& details) {
+    const AuthToken& auth = details.auth;
+    const bool ours = details.account.userid == auth.userid;
+
+    if(ours && details.account.seq > 0U) {
+        return details.api.await(SubmitAPIGet(details, APIRequest::Changes, "/changes?uid=" + std::to_string(auth.userid) +
+                                              "&since=" + std::to_string(details.account.seq), std::string()));
+    }
+
+    // Send the version of our copy, an unchanged account comes back as an empty 304
+    uint64_t id = FetchAccount("/account?uid=" + std::to_string(auth.userid), ours ? std::string(details.account.stamp) : std::string());
+    details.apicalls.emplace(id, PendingCall {APIRequest::Account});
+    return details.api.await(id);
+}
+
+void ReloadAccount(ApplicationDetails& details) {
+    // Without a stamp the server cannot answer 304, so the reload restores the list and its seq
+    details.account.seq = 0U;
+    details.account.stamp.clear();
+    details.cacheDirty = true;
+    RefreshTracks(details);
+}
+
+uint64_t JournalInterval(ApplicationDetails& details, std::chrono::time_point<std::chrono::system_clock> end) {
+    int64_t start = std::chrono::duration_cast<std::chrono::seconds>(details.start.time_since_epoch()).count();
+    int64_t seconds = std::chrono::duration_cast<std::chrono::seconds>(end - details.start).count();
+    if(seconds <= 0) return 0U;
+
+    details.journal.append(details.auth.userid, details.trackName, start, start + seconds);
+    return static_cast<uint64_t>(seconds);
+}
+
+void UploadJournal(ApplicationDetails& details) {
+    // Small enough for the server's form parser to keep the repeated keys as arrays
+    constexpr size_t BATCH_SIZE = 16;
+    static std::vector<JournalEntry> batch;
+    details.journal.batch(details.auth.userid, BATCH_SIZE, batch);
+    if(batch.empty()) {
+        details.nextUpload = std::chrono::steady_clock::time_point::max(); // until something is saved or answered
+        return;
+    }
+
+    std::string postData;
+    EncodeSessionsForm(details.auth.userid, batch, postData);
+    SubmitAPICall(details, APIRequest::Sessions, "/sessions", std::move(postData));
+}
+
+void StoreAccountCache(ApplicationDetails& details) {
+    // At most one encode this often, each is a pass over every track
+    constexpr auto SAVE_INTERVAL = std::chrono::seconds(5);
+
+    details.cacheDirty = false;
+    if(details.account.userid == 0U || details.cachePath.empty()) return; // nobody signed in yet
+    details.nextCacheSave = std::chrono::steady_clock::now() + SAVE_INTERVAL;
+
+    TraceScope trace("encode cache");
+    std::string image;
+    EncodeAccountCache(details.account, details.tracks, image);
+    details.snapshots.save(details.cachePath, std::move(image));
+}
+
+std::optional<std::chrono::time_point<std::chrono::steady_clock>> NextDeadline(const ApplicationDetails& details) {
+    std::optional<std::chrono::time_point<std::chrono::steady_clock>> deadline{};
+    auto consider = [&](std::chrono::time_point<std::chrono::steady_clock> at) {
+        if(!deadline || at < *deadline) deadline = at;
+    };
+
+    // A journal upload waiting to be retried (max: nothing to upload)
+    if(!details.auth.token.empty() && !IsAPICallPending(details, APIRequest::Sessions) &&
+       details.nextUpload != std::chrono::steady_clock::time_point::max()) consider(details.nextUpload);
+
+    // A change stream to reopen, under the conditions the loop opens it on
+    if(!details.auth.token.empty() && details.streamId == 0U && details.account.userid == details.auth.userid &&
+       details.account.seq > 0U) consider(details.streamRetry);
+
+    // A coalesced cache save
+    if(details.cacheDirty) consider(details.nextCacheSave);
+    return deadline;
+}
 
-        if(res != CURLE_OK /* request failed */) {
-//            curl_slist_free_all(headers); // might produce future errors? keep an eye on
-            curl_easy_cleanup(curl);
-            return std::make_pair<bool, std::string>(false, std::string(curl_easy_strerror(res)));
+RenderTicker::RenderTicker() : m_thread(&RenderTicker::run, this) {}
+
+RenderTicker::~RenderTicker() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+}
+
+void RenderTicker::tick(std::optional<std::chrono::time_point<std::chrono::system_clock>> anchor) {
+    {
+        std::lock_guard lock(m_mutex);
+        if(m_anchor == anchor) return;
+        m_anchor = anchor;
+    }
+    m_cv.notify_one();
+}
+
+void RenderTicker::wakeAt(std::optional<std::chrono::time_point<std::chrono::steady_clock>> deadline) {
+    {
+        std::lock_guard lock(m_mutex);
+        if(m_deadline == deadline) return;
+        m_deadline = deadline;
+    }
+    m_cv.notify_one();
+}
+
+void RenderTicker::run() {
+    std::unique_lock lock(m_mutex);
+    while(!m_stop) {
+        if(!m_anchor && !m_deadline) {
+            m_cv.wait(lock);
+            continue;
         }
 
-        // request succeeded
-//        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+        // The display truncates to whole seconds, so land just past the next boundary
+        std::optional<std::chrono::time_point<std::chrono::steady_clock>> next = m_deadline;
+        if(m_anchor) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now() - *m_anchor);
+            auto tick = *m_anchor + elapsed + std::chrono::seconds(1) + std::chrono::milliseconds(5);
+            auto at = std::chrono::steady_clock::now() + (tick - std::chrono::system_clock::now());
+            if(!next || at < *next) next = at;
+        }
 
-        return std::make_pair<bool, std::string>(true, std::move(data));
-    }, std::move(std::string(BASE_API_URL) + "/api" + apiUrl), std::move(postData));
+        if(m_cv.wait_until(lock, *next) == std::cv_status::timeout) {
+            if(m_deadline && std::chrono::steady_clock::now() >= *m_deadline) m_deadline.reset(); // once
+            WakeRenderLoop();
+        }
+    }
 }
 
 bool CountButton::draw(int x, int y, int r) {
+    PROFILE_ZONE("count button");
     constexpr int fontSize = 36;
     if(!m_isCounting)
         if(isHover(x, y, r)) {
@@ -525,7 +1256,108 @@ bool CountButton::isCounting() const {
     return m_isCounting;
 }
 
-int DrawCreateNewTable(char* buf, size_t maxlen) {
+void DrawLastMessage(ApplicationDetails& details, int x, int y, bool centered) {
+    auto& [success, message, shown] = details.lastMessage;
+    if(message.empty()) return;
+    if(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now() - shown).count() > 5) {
+        details.lastMessage = {};
+        return;
+    }
+
+    PROFILE_ZONE("text");
+    const int fontSize = 14;
+    if(centered) x -= MeasureText(message.c_str(), fontSize) / 2;
+    DrawText(message.c_str(), x, y, fontSize, success ? WHITE : RED);
+}
+
+void DrawLoginPage(ApplicationDetails& details) {
+    DrawLogin(details);
+    DrawLastMessage(details, 300, 450, true);
+    const int fontSize = 14;
+    std::string serverMessage = "Server: " + std::string(BASE_API_URL);
+    DrawText(serverMessage.c_str(), 300 - (MeasureText(serverMessage.c_str(), fontSize) / 2), 455 + fontSize, fontSize, WHITE);
+}
+
+void DrawPickerPage(ApplicationDetails& details) {
+    DrawProjectPicker(details);
+    DrawLastMessage(details, 300, 450, true);
+}
+
+void DrawTrackPage(ApplicationDetails& details, CountButton& countButton) {
+    AuthToken& auth = details.auth;
+    const std::string& trackName = details.trackName;
+    uint64_t& sessionSeconds = details.sessionSeconds;
+
+    // Determine counting state and draw the button
+    bool wasCounting = countButton.isCounting();
+    if(countButton.draw(300, 400, 220)) {
+        countButton.toggleCounting();
+        if(!wasCounting) details.start = std::chrono::system_clock::now();
+    }
+    bool isCounting = countButton.isCounting();
+
+    // Get the # of sessionSeconds passed since counting
+    uint32_t uncountedSeconds = isCounting ? std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now() - details.start).count() : 0U;
+
+    // Draw the current counting time OR save the duration to sessionSeconds
+    if(isCounting) {
+        char hmsStr[HMS_BUFFER_SIZE];
+        FormatHMS(uncountedSeconds, hmsStr);
+        DrawText(hmsStr, 300 - (MeasureText(hmsStr, 36) / 2), 700, 36, WHITE);
+    } else if(wasCounting && !isCounting) {
+        // Add duration
+        sessionSeconds += JournalInterval(details, std::chrono::system_clock::now());
+    }
+
+    // Draw the live state of the work log
+    {
+        PROFILE_ZONE("text");
+        char numberStr[HMS_BUFFER_SIZE];
+        DrawText("Total: ", 10, 5, 20, WHITE);
+        FormatUInt(details.savedSeconds + details.journal.unsentSeconds(auth.userid, trackName) + sessionSeconds + uncountedSeconds, numberStr);
+        DrawText(numberStr, 120, 5, 20, WHITE);
+        DrawText("Session: ", 10, 35, 20, WHITE);
+        FormatHMS(sessionSeconds + uncountedSeconds, numberStr);
+        DrawText(numberStr, 120, 35, 20, WHITE);
+        DrawText("Track: ", 10, 65, 20, WHITE);
+        DrawText(trackName.c_str(), 120, 65, 20, WHITE);
+    }
+
+    // Draw the Sync and Sync & Save and Reset buttons
+    // Lock Sync while a sync or an upload is awaiting its API callback, lock Save and Reset if counting
+    bool saving = IsAPICallPending(details, APIRequest::Sessions);
+    if(saving || IsAPICallPending(details, APIRequest::Count)) GuiDisable();
+    if(GuiButton(Rectangle {10.f, 95.f, 85.f, 25.f}, "Sync")) {
+        // Sync with server
+        SubmitAPICall(details, APIRequest::Count, "/count", TrackForm(trackName, auth.userid));
+    }
+    GuiEnable();
+    if(isCounting || sessionSeconds == 0U) GuiDisable();
+    if(GuiButton(Rectangle {105.f, 95.f, 85.f, 25.f}, "Save")) {
+        // The session is journaled already, let the uploader send it now
+        TraceInstant("save");
+        details.journal.release(auth.userid, trackName);
+        details.nextUpload = {};
+        sessionSeconds = 0U;
+    }
+    // Draw the Reset button
+    if(GuiButton(Rectangle {295.f, 95.f, 85.f, 25.f}, "Reset")) {
+        // Reset session count
+        details.journal.discard(auth.userid, trackName);
+        sessionSeconds = 0U;
+    }
+    GuiEnable();
+
+    // Draw the Logout button
+    if(GuiButton(Rectangle {200.f, 95.f, 85.f, 25.f}, "Logout")) {
+        // Sign out of session
+        details.promptedLogout = true;
+    }
+
+    DrawLastMessage(details, 395, 103, false);
+}
+
+int DrawCreateNewTable(char* buf, size_t maxlen, bool duplicate) {
     GuiPanel(Rectangle {10.f, 10.f, 600.f - 20.f, 800.f - 20.f}, "New Track");
     static bool selected = true;
     auto textBounds = Rectangle {60.f, 45.f, 150.f, 50.f};
@@ -539,86 +1371,131 @@ int DrawCreateNewTable(char* buf, size_t maxlen) {
 
     GuiTextBox(textBounds, buf, maxlen, selected);
 
+    // The server matches track names case-insensitively, catch conflicts before sending /new
+    if(duplicate) DrawText("A track with this name already exists.", 60, 100, 14, RED);
+
     if(GuiButton(Rectangle{60.f, 125.f, 75.f, 50.f}, "Cancel")) return 1;
 
-    if(GuiButton(Rectangle{150.f, 125.f, 75.f, 50.f}, "Create")) return 2;
+    if(duplicate || buf[0] == 0) GuiDisable();
+    bool create = GuiButton(Rectangle{150.f, 125.f, 75.f, 50.f}, "Create");
+    GuiEnable();
+    if(create) return 2;
 
     return 0;
 }
 
 void DrawProjectPicker(ApplicationDetails& details) {
+    PROFILE_ZONE("picker");
     static bool promptNewTable = false;
     static std::vector<char> newTableBuf(256);
 
     if(promptNewTable) {
-        int result = DrawCreateNewTable(newTableBuf.data(), 255);
+        bool duplicate = details.tracks.find(newTableBuf.data()).has_value();
+        int result = DrawCreateNewTable(newTableBuf.data(), 255, duplicate);
         promptNewTable = result == 0;
         if(result == 2) {
             // Create the table
             std::string trackName(newTableBuf.data());
-            details.apicall = MakeAPICall("/new",
-                                          "track=" + trackName + "&uid=" + std::to_string(details.auth.userid));
-            details.tracksCached = false;
+            SubmitAPICall(details, APIRequest::New, "/new",
+                          TrackForm(trackName, details.auth.userid));
         }
         return;
     }
 
-    auto& tracks = details.trackNames;
+    auto& tracks = details.tracks;
     Rectangle trackBounds = {0.f, 0.f, 300.f, 30.f};
     Rectangle editBounds = {trackBounds.width + 5.f, 0.f, 45.f, trackBounds.height};
     Rectangle deleteBounds = {trackBounds.width + editBounds.width + 10.f, 0.f, 45.f, trackBounds.height};
+    Rectangle panelBounds = {10.f, 45.f, 600.f - 20.f, 800.f - 55.f};
+    PickerState& picker = details.picker;
+    Vector2& scroll = picker.scroll;
+    Rectangle& view = picker.view;
+    std::vector<uint32_t>& visible = picker.visible;
+
+    // Filter box, answered from the track index whenever the text or the tracks change
+    Rectangle filterBounds = {10.f, 10.f, 600.f - 20.f - 140.f, 30.f};
+    if(GuiTextBox(filterBounds, picker.filter, sizeof(picker.filter) - 1, picker.filterEdit)) picker.filterEdit = !picker.filterEdit;
+    if(!picker.filterEdit && picker.filter[0] == 0) DrawText("Search tracks...", filterBounds.x + 8, filterBounds.y + 9, 14, GRAY);
+
+    std::string_view query(picker.filter);
+    if(query != picker.filterQuery || tracks.revision() != picker.filterRevision) {
+        if(tracks.revision() == picker.filterRevision && query.size() > 3 && query.find(picker.filterQuery) != std::string_view::npos)
+            tracks.index().refine(query, visible); // the query only grew, narrow down the last result
+        else
+            tracks.index().search(query, visible);
+
+        if(query != picker.filterQuery) scroll = Vector2 {0.f, 0.f};
+        picker.filterQuery = query;
+        picker.filterRevision = tracks.revision();
+    }
 
     // https://github.com/raysan5/raygui/blob/master/examples/scroll_panel/scroll_panel.c
     // bounds is the size of the control on screen, content is the size of the inner content you are going to draw, Scroll is a pointer to a vector to store the current offset from the bounds to the content, and view is a pointer to the rectangle you would use to clip the content when you draw it later (with BeginScissor)
     // scroll => GuiScrollPanel will set the data in it based on input
-    Rectangle contentBounds = {0.f, 0.f, trackBounds.width + editBounds.width + deleteBounds.width + 25.f, ((trackBounds.height + 5.f) * tracks.size()) + 10.f};
-    static Vector2 scroll = {0}; // TODO: Reset value upon option selection
-    static Rectangle view = {0}; // TODO: Reset value upon option selection
-    GuiScrollPanel(Rectangle {10.f, 10.f, 600.f - 20.f, 800.f - 20.f}, "Pick a track", contentBounds, &scroll, &view);
+    Rectangle contentBounds = {0.f, 0.f, trackBounds.width + editBounds.width + deleteBounds.width + 25.f, ((trackBounds.height + 5.f) * visible.size()) + 10.f};
+    GuiScrollPanel(panelBounds, "Pick a track", contentBounds, &scroll, &view);
+
+    // Only visit the rows that intersect the view: row i starts at rowPitch * (i + 1) + scroll.y + panel top
+    const float rowPitch = trackBounds.height + 5.f;
+    const float rowOffset = scroll.y + panelBounds.y;
+    const float firstRow = std::floor((view.y - trackBounds.height - rowOffset) / rowPitch);
+    const float lastRow = std::ceil((view.y + view.height - rowOffset) / rowPitch);
+    const size_t first = firstRow > 0.f ? static_cast<size_t>(firstRow) : 0UL;
+    const size_t last = lastRow > 0.f ? std::min(static_cast<size_t>(lastRow), visible.size()) : 0UL;
 
     BeginScissorMode(view.x, view.y, view.width, view.height);
-    for(auto i = 0UL; i < tracks.size(); i++) {
+    for(size_t i = first; i < last; i++) {
         auto bounds = trackBounds;
         bounds.x += scroll.x + 15.f;
-        bounds.y += ((trackBounds.height + 5.f) * (i + 1)) + scroll.y + 10.f;
-        if(CheckCollisionRecs(view, bounds)) { // only render if in bounds (saves the GPU)
-            // Track button
-            if(GuiButton(bounds, tracks[i].c_str())) {
-                printf("User selected track #%d\n", i + 1);
-                details.trackName = tracks[i];
-                details.apicall = MakeAPICall("/count",
-                                      "track=" + details.trackName + "&uid=" + std::to_string(details.auth.userid));
-            }
+        bounds.y += (rowPitch * (i + 1)) + rowOffset;
+
+        const uint32_t id = visible[i];
+        const TrackRecord& track = tracks[id];
+
+        // Track button
+        if(GuiButton(bounds, track.name.c_str())) {
+            printf("User selected track #%zu\n", i + 1);
+            TraceInstant("track select");
+            CancelAPICalls(details, false);
+            details.trackName = track.name;
+            // Show what the account listing reported right away, revalidate in the background
+            details.savedSeconds = track.seconds;
+            SubmitAPICall(details, APIRequest::Count, "/count",
+                          TrackForm(details.trackName, details.auth.userid));
+        }
 
-            // Edit button
-            bounds.x += editBounds.x;
-            bounds.width = editBounds.width;
-            GuiDisable();
-            if (GuiButton(bounds, "Edit")) {
-                printf("User selected EDIT track #%d\n", i + 1);
-            }
-            GuiEnable();
-
-            // Delete button
-            bounds.x = bounds.x - editBounds.x + deleteBounds.x;
-            bounds.width = deleteBounds.width;
-            if(GuiButton(bounds, "Delete")) {
-                details.apicall = MakeAPICall("/delete",
-                                              "track=" + tracks[i] + "&uid=" + std::to_string(details.auth.userid));
-                tracks.erase(tracks.begin() + i);
-            }
+        // Edit button
+        bounds.x += editBounds.x;
+        bounds.width = editBounds.width;
+        GuiDisable();
+        if (GuiButton(bounds, "Edit")) {
+            printf("User selected EDIT track #%zu\n", i + 1);
+        }
+        GuiEnable();
+
+        // Delete button
+        bounds.x = bounds.x - editBounds.x + deleteBounds.x;
+        bounds.width = deleteBounds.width;
+        if(GuiButton(bounds, "Delete")) {
+            SubmitAPICall(details, APIRequest::Delete, "/delete",
+                          TrackForm(track.name, details.auth.userid));
+            tracks.erase(id);
+            details.account.stamp.clear(); // our copy no longer matches any server version
+            details.cacheDirty = true;
+            break; // the rows below move up once the filter refreshes next frame
         }
     }
     EndScissorMode();
 
-    if(GuiButton({10.f + 600.f - 20.f - 130.f, 12.f, 125.f, 20.f}, "New Track")) {
+    if(GuiButton({10.f + 600.f - 20.f - 130.f, 10.f, 130.f, 30.f}, "New Track")) {
         promptNewTable = true;
         memset(newTableBuf.data(), 0, 255);
     }
 
 }
 
-void DrawLogin(APIResult * apicall) {
+void DrawLogin(ApplicationDetails& details) {
+    PROFILE_ZONE("login");
     constexpr unsigned long maxsize = 50;
     static char username[maxsize] = {0};
     static char password[maxsize] = {0};
@@ -644,10 +1521,12 @@ void DrawLogin(APIResult * apicall) {
     GuiTextBox(usernameBounds, username, maxsize - 1, selected == 0 ? 1 : 0);
     GuiTextBox(passwordBounds, password, maxsize - 1, selected == 1 ? 1 : 0);
 
-    bool apiCallOngoing = apicall->valid();
+    bool apiCallOngoing = IsAPICallPending(details, APIRequest::Login) || IsAPICallPending(details, APIRequest::Register);
 
     if(apiCallOngoing || username[0] == 0 || password[0] == 0) GuiDisable();
-    if(GuiButton(Rectangle {x, y + 145.f, 75.f, 50.f}, "Log in")) {
+    bool login = GuiButton(Rectangle {x, y + 145.f, 75.f, 50.f}, "Log in");
+    bool registering = GuiButton(Rectangle {x + 85.f, y + 145.f, 75.f, 50.f}, "Register");
+    if(login || registering) {
         std::string user = username;
         std::string pass = password;
 
@@ -657,71 +1536,280 @@ void DrawLogin(APIResult * apicall) {
         printf("Username: %s\n", user.c_str());
         printf("Password: %s\n", pass.c_str());
 
-        {
-            CURL* curl = curl_easy_init();
-            if(curl) {
-                char* userSanitized = curl_easy_escape(curl, user.c_str(), user.size());
-                char* passSanitized = curl_easy_escape(curl, pass.c_str(), pass.size());
-                user = std::string(userSanitized);
-                pass = std::string(passSanitized);
-                curl_free(userSanitized);
-                curl_free(passSanitized);
-            } else throw std::runtime_error("Failed to initialize CURL.");
-            curl_easy_cleanup(curl);
+        // Register goes on to log in with the same details
+        details.api.spawn(SignIn(details, registering, std::move(user), std::move(pass)));
+    }
+    GuiEnable();
+}
+
+void DrawLatencyOverlay(const LatencyStats& latency) {
+    constexpr int fontSize = 10, rowHeight = 14, nameWidth = 64, countWidth = 36, phaseWidth = 70;
+    const auto& endpoints = latency.endpoints();
+    const int height = rowHeight * (static_cast<int>(endpoints.size()) + 2) + 8;
+    const int top = GetScreenHeight() - height;
+    DrawRectangle(0, top, GetScreenWidth(), height, Fade(BLACK, 0.8f));
+
+    int y = top + 4;
+    DrawText("p50/p99 ms", 4, y, fontSize, GRAY);
+    DrawText("n", 4 + nameWidth, y, fontSize, GRAY);
+    for(size_t i = 0; i < static_cast<size_t>(LatencyPhase::Count); i++)
+        DrawText(LatencyPhaseName(static_cast<LatencyPhase>(i)), 4 + nameWidth + countWidth + static_cast<int>(i) * phaseWidth, y, fontSize, GRAY);
+
+    if(endpoints.empty()) DrawText("No calls yet", 4, y + rowHeight, fontSize, WHITE);
+    for(const LatencyStats::Endpoint& endpoint : endpoints) {
+        y += rowHeight;
+        DrawText(endpoint.name.c_str(), 4, y, fontSize, WHITE);
+        DrawText(std::to_string(endpoint[LatencyPhase::Total].count()).c_str(), 4 + nameWidth, y, fontSize, WHITE);
+        for(size_t i = 0; i < endpoint.phases.size(); i++) {
+            const LatencyHistogram& histogram = endpoint.phases[i];
+            char cell[32];
+            snprintf(cell, sizeof(cell), "%.1f/%.1f", histogram.percentile(50.0) / 1000.0, histogram.percentile(99.0) / 1000.0);
+            DrawText(cell, 4 + nameWidth + countWidth + static_cast<int>(i) * phaseWidth, y, fontSize, WHITE);
         }
+    }
+}
 
-        *apicall = MakeAPICall("/login", "username=" + user +"&password=" + pass);
+#ifdef TIMETRACKER_PROFILING
+void DrawProfilerOverlay(std::chrono::nanoseconds budget) {
+    PROFILE_ZONE("overlay");
+    const FrameProfiler& profiler = Profiler();
+    constexpr int fontSize = 10, rowHeight = 12, graphHeight = 48;
+    constexpr int width = static_cast<int>(FrameProfiler::FRAMES) + 8;
+    const int x = GetScreenWidth() - width - 4, y = 130;
+    const int height = graphHeight + rowHeight * (static_cast<int>(profiler.zones()) + 1) + 12;
+    DrawRectangle(x, y, width, height, Fade(BLACK, 0.8f));
+
+    // One bar per frame, newest on the right, scaled to the slowest frame (at least the budget)
+    const uint64_t budgetNs = budget.count();
+    uint64_t scale = budgetNs;
+    size_t over = 0;
+    for(size_t age = 0; age < profiler.frames(); age++) {
+        scale = std::max(scale, profiler.frameTime(age));
+        if(profiler.frameTime(age) > budgetNs) over++;
     }
-    if(GuiButton(Rectangle {x + 85.f, y + 145.f, 75.f, 50.f}, "Register")) {
-        std::string user = username;
-        std::string pass = password;
+    const int graphBottom = y + 4 + graphHeight;
+    for(size_t age = 0; age < profiler.frames(); age++) {
+        uint64_t frame = profiler.frameTime(age);
+        int bar = std::max(1, static_cast<int>(frame * graphHeight / scale));
+        DrawRectangle(x + 4 + static_cast<int>(FrameProfiler::FRAMES - 1U - age), graphBottom - bar, 1, bar, frame > budgetNs ? RED : GREEN);
+    }
+    DrawRectangle(x + 4, graphBottom - static_cast<int>(budgetNs * graphHeight / scale), static_cast<int>(FrameProfiler::FRAMES), 1, YELLOW);
+
+    char line[96];
+    int textY = graphBottom + 4;
+    snprintf(line, sizeof(line), "frame p50 %.2f p99 %.2f ms, %zu over", profiler.framePercentile(50.0) / 1e6, profiler.framePercentile(99.0) / 1e6, over);
+    DrawText(line, x + 4, textY, fontSize, WHITE);
+    for(size_t zone = 0; zone < profiler.zones(); zone++) {
+        textY += rowHeight;
+        snprintf(line, sizeof(line), "%-14s p50 %.2f p99 %.2f", profiler.zoneName(zone), profiler.zonePercentile(zone, 50.0) / 1e6, profiler.zonePercentile(zone, 99.0) / 1e6);
+        DrawText(line, x + 4, textY, fontSize, GRAY);
+    }
+}
+#endif
 
-        memset(username, 0, maxsize);
-        memset(password, 0, maxsize);
+/* UI benchmark */
 
-        printf("Username: %s\n", user.c_str());
-        printf("Password: %s\n", pass.c_str());
+static uint64_t s_drawCalls = 0;
 
-        {
-            CURL* curl = curl_easy_init();
-            if(curl) {
-                char* userSanitized = curl_easy_escape(curl, user.c_str(), user.size());
-                char* passSanitized = curl_easy_escape(curl, pass.c_str(), pass.size());
-                user = std::string(userSanitized);
-                pass = std::string(passSanitized);
-                curl_free(userSanitized);
-                curl_free(passSanitized);
-            } else throw std::runtime_error("Failed to initialize CURL.");
-            curl_easy_cleanup(curl);
-        }
+#ifdef TIMETRACKER_DRAW_CALLS
+static GLDrawArraysProc s_glDrawArrays = nullptr;
+static GLDrawElementsProc s_glDrawElements = nullptr;
+
+static void TIMETRACKER_GL_APIENTRY CountDrawArrays(unsigned int mode, int first, int count) {
+    s_drawCalls++;
+    s_glDrawArrays(mode, first, count);
+}
+
+static void TIMETRACKER_GL_APIENTRY CountDrawElements(unsigned int mode, int count, unsigned int type, const void* indices) {
+    s_drawCalls++;
+    s_glDrawElements(mode, count, type, indices);
+}
+#endif
+
+/**
+ * Count raylib's draw calls in s_drawCalls from now on, call after InitWindow() loaded GL
+ * @return Boolean for whether they are counted
+ */
+static bool CountDrawCalls() {
+#ifdef TIMETRACKER_DRAW_CALLS
+    if(glad_glDrawArrays == nullptr || glad_glDrawElements == nullptr) return false;
+    s_glDrawArrays = glad_glDrawArrays;
+    s_glDrawElements = glad_glDrawElements;
+    glad_glDrawArrays = CountDrawArrays;
+    glad_glDrawElements = CountDrawElements;
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @return CPU time of the calling thread in nanoseconds, wall time on Windows
+ */
+static uint64_t ThreadCPUTime() {
+#ifdef _WIN32
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+#endif
+}
+
+/**
+ * One page with one input script
+ */
+struct UIScenario {
+    const char* page;       // login, picker or track
+    const char* script;
+    size_t tracks;
+    void (*input)(ApplicationDetails& details, CountButton& countButton, size_t frame);
+};
+
+static void ScriptIdle(ApplicationDetails&, CountButton&, size_t) {}
+
+static void ScriptHover(ApplicationDetails&, CountButton&, size_t frame) {
+    // Sweep the whole page, passing over every control
+    SetMousePosition(static_cast<int>(frame * 37U % 600U), static_cast<int>(frame * 53U % 800U));
+}
 
-        *apicall = MakeAPICall("/register", "username=" + user +"&password=" + pass);
+static void ScriptScroll(ApplicationDetails& details, CountButton&, size_t frame) {
+    // Three rows a frame, back to the top once past the end (GuiScrollPanel clamps to the list)
+    size_t rows = std::max<size_t>(details.picker.visible.size(), 1U);
+    details.picker.scroll.y = -35.f * static_cast<float>(frame * 3U % rows);
+}
+
+static void ScriptFilter(ApplicationDetails& details, CountButton&, size_t frame) {
+    // Type the query a character a frame, then start over
+    static constexpr char query[] = "task 1234";
+    size_t length = frame % sizeof(query);
+    memcpy(details.picker.filter, query, length);
+    details.picker.filter[length] = '\0';
+}
+
+static void ScriptMessage(ApplicationDetails& details, CountButton&, size_t) {
+    static const std::string message = []() {
+        std::string text;
+        for(int i = 0; i < 8; i++) text += "Could not reach the server, counted time stays in the journal until it does. ";
+        return text;
+    }();
+    details.lastMessage = {false, message, std::chrono::system_clock::now()};
+}
+
+static void ScriptCounting(ApplicationDetails& details, CountButton& countButton, size_t frame) {
+    if(frame == 0U) {
+        countButton.toggleCounting();
+        details.start = std::chrono::system_clock::now() - std::chrono::seconds(3723);
     }
-    GuiEnable();
 }
 
-std::string SecondsToHMS(uint64_t seconds) {
-    auto hh = std::chrono::duration_cast<std::chrono::hours>(std::chrono::seconds(seconds));
-    auto mm = std::chrono::duration_cast<std::chrono::minutes>(std::chrono::seconds(seconds) - hh);
-    auto ss = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::seconds(seconds) - hh - mm);
+int RunUIBenchmark(const std::string& reportPath) {
+    constexpr size_t warmUpFrames = 30, frames = 300;
+    static const UIScenario scenarios[] = {
+        {"login", "idle", 0, ScriptIdle},
+        {"login", "hover", 0, ScriptHover},
+        {"login", "message", 0, ScriptMessage},
+        {"picker", "idle", 10, ScriptIdle},
+        {"picker", "idle", 1000, ScriptIdle},
+        {"picker", "idle", 100000, ScriptIdle},
+        {"picker", "scroll", 10, ScriptScroll},
+        {"picker", "scroll", 1000, ScriptScroll},
+        {"picker", "scroll", 100000, ScriptScroll},
+        {"picker", "filter", 10, ScriptFilter},
+        {"picker", "filter", 1000, ScriptFilter},
+        {"picker", "filter", 100000, ScriptFilter},
+        {"picker", "hover", 1000, ScriptHover},
+        {"picker", "message", 1000, ScriptMessage},
+        {"track", "idle", 0, ScriptIdle},
+        {"track", "counting", 0, ScriptCounting},
+        {"track", "hover", 0, ScriptHover},
+        {"track", "message", 0, ScriptMessage}
+    };
 
-    if(hh.count() > 0ULL) {
-        // HH:MM:SS
-        std::string s_ss = ss.count() > 9ULL ? std::to_string(ss.count()) : "0" + std::to_string(ss.count());
-        std::string s_mm = mm.count() > 9ULL ? std::to_string(mm.count()) : "0" + std::to_string(mm.count());
-        std::string s_hh = std::to_string(hh.count());
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(600, 800, DEFAULT_WIN_TITLE);
+    if(!IsWindowReady()) {
+        fprintf(stderr, "Could not open a window for the UI benchmark (no display? try xvfb-run)\n");
+        return 1;
+    }
+    GuiLoadStyleCyber();
+    RenderTexture2D target = LoadRenderTexture(600, 800);
+    Color backgroundColor = RGBToColor(41U, 44U, 51U);
+    bool drawCalls = CountDrawCalls();
+
+    // {"unit":"us","frames":..,"runs":[{"page":..,"script":..,"tracks":..,"cpu":{..},"wall":{..},"drawCalls":{..}},..]}
+    std::string json = R"({"unit":"us","frames":)" + std::to_string(frames) + R"(,"runs":[)";
+    char field[256];
+    printf("%-7s %-9s %7s %10s %10s %10s %10s %7s %5s\n", "page", "script", "tracks", "cpu p50", "cpu p99", "cpu max", "wall p50", "draws", "max");
+    for(const UIScenario& scenario : scenarios) {
+        auto details = std::make_unique<ApplicationDetails>();
+        details->auth = AuthToken {"benchmark", "benchmark", 1, {}};
+        auto now = std::chrono::system_clock::now();
+        for(size_t i = 0; i < scenario.tracks; i++)
+            details->tracks.insert("Project " + std::to_string(i % 97) + " - task " + std::to_string(i), (i * 7919U) % 360000U, now);
+        if(strcmp(scenario.page, "track") == 0) {
+            details->trackName = "Project 12 - task 3";
+            details->savedSeconds = 18234U;
+            details->sessionSeconds = 600U;
+        }
+        CountButton countButton;
+        SetMousePosition(599, 799); // over nothing
+
+        LatencyHistogram cpu, wall;
+        uint64_t drawCallSum = 0, drawCallMax = 0;
+        for(size_t frame = 0; frame < warmUpFrames + frames; frame++) {
+            auto frameStart = std::chrono::steady_clock::now();
+            BeginDrawing();
+            scenario.input(*details, countButton, frame);
+
+            uint64_t cpuStart = ThreadCPUTime();
+            uint64_t drawCallStart = s_drawCalls;
+            BeginTextureMode(target);
+            ClearBackground(backgroundColor);
+            if(strcmp(scenario.page, "login") == 0) DrawLoginPage(*details);
+            else if(strcmp(scenario.page, "picker") == 0) DrawPickerPage(*details);
+            else DrawTrackPage(*details, countButton);
+            EndTextureMode(); // submits the batch
+            uint64_t cpuTime = ThreadCPUTime() - cpuStart;
+            uint64_t frameDrawCalls = s_drawCalls - drawCallStart;
+
+            EndDrawing();
+            if(frame < warmUpFrames) continue;
+            cpu.record(cpuTime);
+            wall.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - frameStart).count());
+            drawCallSum += frameDrawCalls;
+            drawCallMax = std::max(drawCallMax, frameDrawCalls);
+        }
 
-        return s_hh + ":" + s_mm + ":" + s_ss;
-    } else if(mm.count() > 0ULL) {
-        // MM:SS
-        std::string s_ss = ss.count() > 9ULL ? std::to_string(ss.count()) : "0" + std::to_string(ss.count());
-        std::string s_mm = std::to_string(mm.count());
+        double drawCallMean = static_cast<double>(drawCallSum) / frames;
+        printf("%-7s %-9s %7zu %10.1f %10.1f %10.1f %10.1f ", scenario.page, scenario.script, scenario.tracks, cpu.percentile(50.0) / 1e3,
+               cpu.percentile(99.0) / 1e3, cpu.max() / 1e3, wall.percentile(50.0) / 1e3);
+        if(drawCalls) printf("%7.1f %5llu\n", drawCallMean, static_cast<unsigned long long>(drawCallMax));
+        else printf("%7s %5s\n", "-", "-");
+
+        snprintf(field, sizeof(field), R"(%s{"page":"%s","script":"%s","tracks":%zu)", &scenario == scenarios ? "" : ",", scenario.page, scenario.script, scenario.tracks);
+        json += field;
+        for(auto [name, histogram] : {std::pair {"cpu", &cpu}, std::pair {"wall", &wall}}) {
+            snprintf(field, sizeof(field), R"(,"%s":{"mean":%.1f,"p50":%.1f,"p90":%.1f,"p99":%.1f,"max":%.1f})", name, histogram->mean() / 1e3,
+                     histogram->percentile(50.0) / 1e3, histogram->percentile(90.0) / 1e3, histogram->percentile(99.0) / 1e3, histogram->max() / 1e3);
+            json += field;
+        }
+        if(drawCalls) snprintf(field, sizeof(field), R"(,"drawCalls":{"mean":%.1f,"max":%llu}})", drawCallMean, static_cast<unsigned long long>(drawCallMax));
+        else snprintf(field, sizeof(field), R"(,"drawCalls":null})");
+        json += field;
+    }
+    json += "]}\n";
 
-        return s_mm + ":" + s_ss;
-    } else {
-        // SS
-        std::string s_ss = std::to_string(ss.count());
+    UnloadRenderTexture(target);
+    CloseWindow();
 
-        return s_ss;
+    if(reportPath.empty()) return 0;
+    std::ofstream out(reportPath, std::ios::binary | std::ios::trunc);
+    out.write(json.data(), static_cast<std::streamsize>(json.size()));
+    if(!out) {
+        fprintf(stderr, "Could not write the UI benchmark report to %s\n", reportPath.c_str());
+        return 1;
     }
-}
\ No newline at end of file
+    printf("UI benchmark written to %s\n", reportPath.c_str());
+    return 0;
+}
@@ -0,0 +1,660 @@
+/* Standard headers */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/* Third Party headers */
+#include <curl/curl.h>
+
+#include "network.h"
+#include "spsc_queue.h"
+#include "trace.h"
+
+/**
+ * libcurl curl_easy_* WriteFunction for std::string
+ * @param data The recv'd bytes
+ * @param chunkSize Size per chunk
+ * @param numChunks Number of chunks recv'd
+ * @param str Pointer to string buffer
+ * @return Total size of bytes recv'd
+ */
+static size_t curl_easy_writefn_str(void *data, size_t chunkSize, size_t numChunks, std::string *str);
+
+namespace { struct Transfer; }
+
+/**
+ * libcurl curl_easy_* WriteFunction feeding the decoder of a transfer
+ * @param data Chunk data
+ * @param chunkSize Size per chunk
+ * @param numChunks Number of chunks recv'd
+ * @param transfer Pointer to the transfer, its decoder is fed and its parse time counted
+ * @return Total size of bytes recv'd, 0 (abort) once the body is not valid JSON
+ */
+static size_t curl_easy_writefn_decoder(void *data, size_t chunkSize, size_t numChunks, Transfer *transfer);
+
+/**
+ * Read the phase timings of a finished transfer
+ * @param curl The easy handle
+ * @param timing Receives the phases curl measured
+ */
+static void ReadTransferTiming(CURL* curl, RequestTiming& timing);
+
+/**
+ * libcurl curl_easy_* HeaderFunction picking out the ETag
+ * @param data One header line
+ * @param chunkSize Size per chunk
+ * @param numChunks Number of chunks recv'd
+ * @param etag Pointer to the ETag string
+ * @return Total size of bytes recv'd
+ */
+static size_t curl_easy_headerfn_etag(char *data, size_t chunkSize, size_t numChunks, std::string *etag);
+
+/* Network worker */
+
+namespace {
+
+struct Transfer {
+    uint64_t id;
+    std::string url;
+    std::string postData;
+    std::string response;
+    bool get = false;
+    std::string ifNoneMatch;
+    std::string etag;
+    curl_slist* headers = nullptr;
+    bool warmUp = false;    // GET whose only purpose is to leave a connection in the pool, never delivered
+    bool stream = false;    // Server-Sent Events, response holds the unparsed rest
+    std::string event;      // data of the stream event being received
+    std::unique_ptr<ResponseDecoder> decoder;    // decodes the body instead of collecting it in response
+    std::chrono::steady_clock::time_point queued;
+    RequestTiming timing;
+
+    ~Transfer() { curl_slist_free_all(headers); }
+};
+
+class APIEngine {
+public:
+    explicit APIEngine(void (*wake)());
+    ~APIEngine();
+
+    APIEngine(const APIEngine&) = delete;
+    APIEngine& operator=(const APIEngine&) = delete;
+
+    /**
+     * Queue a request for the worker
+     * @param apiUrl Full URL to send a request to
+     * @param postData The POST data
+     * @return Request id of the queued transfer
+     */
+    uint64_t submit(std::string&& apiUrl, std::string&& postData);
+
+    /**
+     * Queue a GET request for the worker
+     * @param apiUrl Full URL to send a request to
+     * @param ifNoneMatch ETag to send in If-None-Match (may be empty)
+     * @return Request id of the queued transfer
+     */
+    uint64_t submitGet(std::string&& apiUrl, std::string&& ifNoneMatch);
+
+    /**
+     * Queue a GET request whose body is decoded as an /account response while it arrives
+     * @param apiUrl Full URL to send a request to
+     * @param ifNoneMatch ETag to revalidate, may be empty
+     * @return Request id of the queued transfer
+     */
+    uint64_t fetchAccount(std::string&& apiUrl, std::string&& ifNoneMatch);
+
+    /**
+     * Queue a Server-Sent Events stream
+     * @param apiUrl Full URL to stream from
+     * @return Request id of the stream
+     */
+    uint64_t openStream(std::string&& apiUrl);
+
+    /**
+     * Stop a transfer (queued, running or streaming) without reporting anything more for it
+     * @param id Request id of the transfer
+     */
+    void cancel(uint64_t id);
+
+    /**
+     * Queue a GET that resolves and connects to the server without reporting back
+     * @param apiUrl Full URL to send a request to
+     */
+    void warmUp(std::string&& apiUrl);
+
+    /**
+     * Take the next completed transfer (render loop only)
+     * @param response Receives the completed transfer
+     * @return Boolean for whether one was available
+     */
+    bool poll(APIResponse& response);
+
+private:
+    CURLM* m_multi = nullptr;
+    CURLSH* m_share = nullptr;
+    std::mutex m_shareLocks[CURL_LOCK_DATA_LAST];
+    std::thread m_worker;
+    std::atomic<bool> m_running = true;
+    std::atomic<uint64_t> m_nextId = 1;
+    void (*m_wake)() = nullptr;
+
+    // worker -> render loop
+    SPSCQueue<APIResponse, 256> m_completed;
+
+    // shared with submit(), guarded by m_mutex
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<Transfer>> m_queued;
+    std::vector<uint64_t> m_cancelled;
+
+    // owned by the worker thread
+    std::unordered_map<CURL*, std::unique_ptr<Transfer>> m_active;
+    std::vector<CURL*> m_idleHandles;
+    std::vector<APIResponse> m_backlog; // completions that did not fit into m_completed
+
+    /**
+     * Hand a transfer to the worker
+     * @param transfer The transfer, gets its id assigned
+     * @return Request id of the transfer
+     */
+    uint64_t queue(std::unique_ptr<Transfer> transfer);
+
+    /**
+     * Worker loop: start queued transfers, drive the multi handle, resolve finished ones
+     */
+    void run();
+
+    /**
+     * Configure an easy handle for a transfer and hand it to the multi handle
+     * @param transfer The queued transfer
+     */
+    void start(std::unique_ptr<Transfer> transfer);
+
+    /**
+     * Resolve a finished transfer and recycle its easy handle
+     * @param curl The easy handle
+     * @param result Transfer result code
+     */
+    void finish(CURL* curl, CURLcode result);
+
+    /**
+     * Turn the complete events a stream received so far into responses
+     * @param transfer The stream
+     */
+    void parseEvents(Transfer& transfer);
+
+    /**
+     * Hand completions to the render loop, keeping any that do not fit for later
+     * @return Boolean for whether anything was delivered
+     */
+    bool deliver();
+
+    /**
+     * curl_share lock callbacks, one mutex per kind of shared data
+     */
+    static void lockShare(CURL* curl, curl_lock_data data, curl_lock_access access, void* engine);
+    static void unlockShare(CURL* curl, curl_lock_data data, void* engine);
+};
+
+APIEngine::APIEngine(void (*wake)()) : m_wake(wake) {
+    m_multi = curl_multi_init();
+    if(m_multi == nullptr) throw std::runtime_error("Could not initialize CURL multi.");
+
+    // The multi handle already pools connections for its transfers, the share object adds the
+    // DNS cache and TLS session tickets for every handle in the process
+    m_share = curl_share_init();
+    if(m_share == nullptr) {
+        // The destructor does not run for a constructor that throws
+        curl_multi_cleanup(m_multi);
+        throw std::runtime_error("Could not initialize CURL share.");
+    }
+    curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, &APIEngine::lockShare);
+    curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, &APIEngine::unlockShare);
+    curl_share_setopt(m_share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    try {
+        m_worker = std::thread(&APIEngine::run, this);
+    } catch(...) {
+        curl_share_cleanup(m_share);
+        curl_multi_cleanup(m_multi);
+        throw;
+    }
+}
+
+APIEngine::~APIEngine() {
+    m_running = false;
+    curl_multi_wakeup(m_multi);
+    if(m_worker.joinable()) m_worker.join();
+
+    // anything still around never completes
+    for(auto& [curl, transfer] : m_active) {
+        curl_multi_remove_handle(m_multi, curl);
+        curl_easy_cleanup(curl);
+    }
+    for(CURL* curl : m_idleHandles)
+        curl_easy_cleanup(curl);
+
+    curl_multi_cleanup(m_multi);
+    curl_share_cleanup(m_share);
+}
+
+uint64_t APIEngine::submit(std::string&& apiUrl, std::string&& postData) {
+    auto transfer = std::make_unique<Transfer>();
+    transfer->url = std::move(apiUrl);
+    transfer->postData = std::move(postData);
+    return queue(std::move(transfer));
+}
+
+uint64_t APIEngine::submitGet(std::string&& apiUrl, std::string&& ifNoneMatch) {
+    auto transfer = std::make_unique<Transfer>();
+    transfer->url = std::move(apiUrl);
+    transfer->get = true;
+    transfer->ifNoneMatch = std::move(ifNoneMatch);
+    return queue(std::move(transfer));
+}
+
+uint64_t APIEngine::fetchAccount(std::string&& apiUrl, std::string&& ifNoneMatch) {
+    auto transfer = std::make_unique<Transfer>();
+    transfer->url = std::move(apiUrl);
+    transfer->get = true;
+    transfer->ifNoneMatch = std::move(ifNoneMatch);
+    transfer->decoder = std::make_unique<ResponseDecoder>();
+    return queue(std::move(transfer));
+}
+
+uint64_t APIEngine::openStream(std::string&& apiUrl) {
+    auto transfer = std::make_unique<Transfer>();
+    transfer->url = std::move(apiUrl);
+    transfer->get = true;
+    transfer->stream = true;
+    return queue(std::move(transfer));
+}
+
+void APIEngine::cancel(uint64_t id) {
+    {
+        std::lock_guard lock(m_mutex);
+        // Not started yet, it never goes out
+        auto queued = std::find_if(m_queued.begin(), m_queued.end(), [id](const auto& transfer) { return transfer->id == id; });
+        if(queued != m_queued.end()) {
+            m_queued.erase(queued);
+            TraceAsyncEnd("request", id, "cancelled");
+            return;
+        }
+        m_cancelled.push_back(id);
+    }
+    curl_multi_wakeup(m_multi);
+}
+
+void APIEngine::warmUp(std::string&& apiUrl) {
+    auto transfer = std::make_unique<Transfer>();
+    transfer->url = std::move(apiUrl);
+    transfer->warmUp = true;
+    queue(std::move(transfer));
+}
+
+uint64_t APIEngine::queue(std::unique_ptr<Transfer> transfer) {
+    transfer->id = m_nextId++;
+    transfer->queued = std::chrono::steady_clock::now();
+    if(TraceEnabled()) {
+        std::string_view path(transfer->url);
+        if(size_t api = path.find("/api/"); api != std::string_view::npos) path.remove_prefix(api + 4U);
+        TraceAsyncBegin("request", transfer->id, path);
+    }
+    uint64_t id = transfer->id;
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_queued.push_back(std::move(transfer));
+    }
+    curl_multi_wakeup(m_multi);
+
+    return id;
+}
+
+bool APIEngine::poll(APIResponse& response) {
+    return m_completed.pop(response);
+}
+
+void APIEngine::run() {
+    TraceThreadName("network");
+    std::vector<std::unique_ptr<Transfer>> queued;
+    std::vector<uint64_t> cancelled;
+
+    while(m_running) {
+        {
+            std::lock_guard lock(m_mutex);
+            queued.swap(m_queued);
+            cancelled.swap(m_cancelled);
+        }
+        for(auto& transfer : queued) start(std::move(transfer));
+        queued.clear();
+
+        // Cancelled transfers are cut off mid-transfer, their handles are not reused
+        for(uint64_t id : cancelled) {
+            auto it = std::find_if(m_active.begin(), m_active.end(), [id](const auto& active) { return active.second->id == id; });
+            if(it == m_active.end()) continue;
+            curl_multi_remove_handle(m_multi, it->first);
+            curl_easy_cleanup(it->first);
+            m_active.erase(it);
+            TraceAsyncEnd("request", id, "cancelled");
+        }
+        cancelled.clear();
+
+        int stillRunning = 0;
+        curl_multi_perform(m_multi, &stillRunning);
+
+        for(auto& [curl, transfer] : m_active)
+            if(transfer->stream) parseEvents(*transfer);
+
+        int msgsLeft = 0;
+        while(CURLMsg* msg = curl_multi_info_read(m_multi, &msgsLeft)) {
+            if(msg->msg == CURLMSG_DONE) finish(msg->easy_handle, msg->data.result);
+        }
+
+        if(deliver() && m_wake != nullptr) m_wake();
+
+        // sleep until there is socket activity, a submit() or a timeout fires
+        // retry soon if the render loop has not caught up with the backlog
+        curl_multi_poll(m_multi, nullptr, 0, m_backlog.empty() ? 1000 : 10, nullptr);
+    }
+}
+
+void APIEngine::start(std::unique_ptr<Transfer> transfer) {
+    transfer->timing.queue = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - transfer->queued).count();
+
+    CURL* curl;
+    if(!m_idleHandles.empty()) {
+        curl = m_idleHandles.back();
+        m_idleHandles.pop_back();
+        curl_easy_reset(curl); // keeps the connection and DNS caches
+    } else curl = curl_easy_init();
+
+    if(curl == nullptr) {
+        m_backlog.push_back(APIResponse {transfer->id, false, "Could not initialize CURL."});
+        TraceAsyncEnd("request", transfer->id, "failed");
+        return;
+    }
+
+    // general configuration
+    curl_easy_setopt(curl, CURLOPT_URL, transfer->url.c_str());
+#ifdef BASE_API_PORT
+    curl_easy_setopt(curl, CURLOPT_PORT, BASE_API_PORT);
+#endif
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    if(transfer->stream) {
+        // Open for as long as the server keeps it, but drop it if even its heartbeats stop
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 0L);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 90L);
+    } else curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_SHARE, m_share); // curl_easy_reset() drops it
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 600L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    // receive data, advertising every encoding this libcurl can decode (gzip, deflate, zstd, ...)
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    if(transfer->decoder) {
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_easy_writefn_decoder);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer.get());
+    } else {
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_easy_writefn_str);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer->response);
+    }
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curl_easy_headerfn_etag);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &transfer->etag);
+
+    // send data
+    if(transfer->warmUp) {
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+        curl_multi_add_handle(m_multi, curl);
+        m_active.emplace(curl, std::move(transfer));
+        return;
+    }
+    if(transfer->get) {
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+        if(transfer->stream) {
+            transfer->headers = curl_slist_append(nullptr, "Accept: text/event-stream");
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer->headers);
+        } else if(!transfer->ifNoneMatch.empty()) {
+            transfer->headers = curl_slist_append(nullptr, ("If-None-Match: " + transfer->ifNoneMatch).c_str());
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer->headers);
+        }
+    } else {
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, transfer->postData.c_str());
+    }
+
+#ifndef NDEBUG
+    const char* method = transfer->stream ? "STREAM" : transfer->get ? "GET" : "POST";
+#ifdef BASE_API_PORT
+    printf("%s REQUEST: %s:%d%s\n", method, BASE_API_URL, BASE_API_PORT, transfer->url.substr(strlen(BASE_API_URL)).c_str());
+#else
+    printf("%s REQUEST: %s\n", method, transfer->url.c_str());
+#endif
+    if(transfer->stream) {
+        // nothing else to show
+    } else if(transfer->get) printf("GET IF-NONE-MATCH: %s\n", transfer->ifNoneMatch.c_str());
+    else printf("POST DATA: %s\n", transfer->postData.c_str());
+    fflush(stdout);
+#endif
+
+    curl_multi_add_handle(m_multi, curl);
+    m_active.emplace(curl, std::move(transfer));
+}
+
+void APIEngine::finish(CURL* curl, CURLcode result) {
+    curl_multi_remove_handle(m_multi, curl);
+
+    auto it = m_active.find(curl);
+    if(it != m_active.end()) {
+        Transfer& transfer = *it->second;
+        if(transfer.warmUp) {
+            // nothing to report, the connection stays in the pool
+        } else if(transfer.stream) {
+            long status = 0;
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+            std::string reason = result != CURLE_OK ? std::string(curl_easy_strerror(result)) : std::string("Stream closed.");
+            m_backlog.push_back(APIResponse {transfer.id, result == CURLE_OK, std::move(reason), status});
+        } else if(transfer.decoder && !transfer.decoder->error().empty()) {
+            // the write callback gave up on a body that is not JSON
+            m_backlog.push_back(APIResponse {transfer.id, false, "Bad response: " + transfer.decoder->error()});
+        } else if(result != CURLE_OK /* request failed */)
+            m_backlog.push_back(APIResponse {transfer.id, false, std::string(curl_easy_strerror(result))});
+        else {
+            long status = 0;
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+            APIResponse response {transfer.id, true, std::move(transfer.response), status, std::move(transfer.etag)};
+            if(transfer.decoder && status != 304) {
+                auto parseStart = std::chrono::steady_clock::now();
+                if(transfer.decoder->finish()) response.decoded = std::make_unique<Response>(std::move(transfer.decoder->response()));
+                else response = APIResponse {transfer.id, false, "Bad response: " + transfer.decoder->error()};
+                transfer.timing.parse += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - parseStart).count();
+            }
+            m_backlog.push_back(std::move(response));
+        }
+
+        // A warm-up reports nothing and the lifetime of a stream is no latency, the rest queued one response
+        if(!transfer.warmUp && !transfer.stream) {
+            ReadTransferTiming(curl, transfer.timing);
+            m_backlog.back().timing = transfer.timing;
+        }
+        TraceAsyncEnd("request", transfer.id, result == CURLE_OK ? "done" : curl_easy_strerror(result));
+        m_active.erase(it);
+    }
+
+    m_idleHandles.push_back(curl);
+}
+
+void APIEngine::parseEvents(Transfer& transfer) {
+    // Lines ending in \n (or \r\n), a blank one ends the event. Only data lines matter to us,
+    // comments (heartbeats), event, id and retry lines are skipped
+    size_t start = 0;
+    for(size_t end; (end = transfer.response.find('\n', start)) != std::string::npos; start = end + 1) {
+        std::string_view line(transfer.response.data() + start, end - start);
+        if(!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+        if(line.empty()) {
+            if(!transfer.event.empty())
+                m_backlog.push_back(APIResponse {transfer.id, true, std::move(transfer.event), 200, std::string(), true});
+            transfer.event.clear();
+        } else if(line.starts_with("data:")) {
+            line.remove_prefix(5);
+            if(!line.empty() && line.front() == ' ') line.remove_prefix(1);
+            if(!transfer.event.empty()) transfer.event += '\n';
+            transfer.event += line;
+        }
+    }
+    transfer.response.erase(0, start);
+}
+
+bool APIEngine::deliver() {
+    size_t delivered = 0;
+    while(delivered < m_backlog.size() && m_completed.push(std::move(m_backlog[delivered]))) delivered++;
+    m_backlog.erase(m_backlog.begin(), m_backlog.begin() + delivered);
+    return delivered > 0;
+}
+
+void APIEngine::lockShare(CURL*, curl_lock_data data, curl_lock_access, void* engine) {
+    static_cast<APIEngine*>(engine)->m_shareLocks[data].lock();
+}
+
+void APIEngine::unlockShare(CURL*, curl_lock_data data, void* engine) {
+    static_cast<APIEngine*>(engine)->m_shareLocks[data].unlock();
+}
+
+std::unique_ptr<APIEngine> s_engine;
+
+} // namespace
+
+/* Method definitions */
+
+static size_t curl_easy_writefn_str(void *data, size_t chunkSize, size_t numChunks, std::string *str) {
+    size_t totalSize = chunkSize * numChunks;
+    str->append(static_cast<char*>(data), totalSize);
+    return totalSize;
+}
+
+static size_t curl_easy_writefn_decoder(void *data, size_t chunkSize, size_t numChunks, Transfer *transfer) {
+    size_t totalSize = chunkSize * numChunks;
+    TraceScope trace("parse");
+    auto parseStart = std::chrono::steady_clock::now();
+    bool ok = transfer->decoder->feed(std::string_view(static_cast<char*>(data), totalSize));
+    transfer->timing.parse += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - parseStart).count();
+    return ok ? totalSize : 0;
+}
+
+static void ReadTransferTiming(CURL* curl, RequestTiming& timing) {
+    // All of these count from the start of the transfer, 0 for phases that did not happen
+    // (a reused connection skips DNS and connect, plain HTTP has no TLS)
+    curl_off_t nameLookup = 0, connect = 0, appConnect = 0, preTransfer = 0, startTransfer = 0, total = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &nameLookup);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appConnect);
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &preTransfer);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &startTransfer);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+
+    auto span = [](curl_off_t from, curl_off_t to) { return to > from ? static_cast<uint64_t>(to - from) : 0U; };
+    timing.dns = span(0, nameLookup);
+    timing.connect = span(nameLookup, connect);
+    timing.tls = appConnect > 0 ? span(connect, appConnect) : 0U;
+    timing.firstByte = startTransfer > 0 ? span(preTransfer, startTransfer) : 0U;
+    timing.total = span(0, total);
+}
+
+/**
+ * Percent-encode a value onto the end of a string
+ * @param out String to append to
+ * @param value Raw value
+ */
+static void AppendURLEncoded(std::string& out, std::string_view value) {
+    static constexpr char hex[] = "0123456789ABCDEF";
+    for(unsigned char c : value) {
+        if((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' || c == '~') {
+            out += static_cast<char>(c);
+        } else {
+            out += '%';
+            out += hex[c >> 4];
+            out += hex[c & 0x0F];
+        }
+    }
+}
+
+std::string URLEncode(std::string_view value) {
+    std::string encoded;
+    encoded.reserve(value.size());
+    AppendURLEncoded(encoded, value);
+    return encoded;
+}
+
+void AppendFormField(std::string& form, std::string_view key, std::string_view value) {
+    if(!form.empty()) form += '&';
+    form += key;
+    form += '=';
+    AppendURLEncoded(form, value);
+}
+
+static size_t curl_easy_headerfn_etag(char *data, size_t chunkSize, size_t numChunks, std::string *etag) {
+    size_t totalSize = chunkSize * numChunks;
+    std::string_view line(data, totalSize);
+    constexpr std::string_view name = "etag:";
+    auto equalFolded = [](char lower, char c) { return lower == (c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c); };
+    if(line.size() > name.size() && std::equal(name.begin(), name.end(), line.begin(), equalFolded)) {
+        line.remove_prefix(name.size());
+        while(!line.empty() && (line.front() == ' ' || line.front() == '\t')) line.remove_prefix(1);
+        while(!line.empty() && (line.back() == '\r' || line.back() == '\n' || line.back() == ' ')) line.remove_suffix(1);
+        etag->assign(line);
+    }
+    return totalSize;
+}
+
+void InitAPI(void (*wake)()) {
+    if(!s_engine) s_engine = std::make_unique<APIEngine>(wake);
+}
+
+void CloseAPI() {
+    s_engine.reset();
+}
+
+uint64_t MakeAPICall(std::string&& apiUrl, std::string&& postData) {
+    if(!s_engine) throw std::runtime_error("API not initialized.");
+    return s_engine->submit(std::string(BASE_API_URL) + "/api" + apiUrl, std::move(postData));
+}
+
+uint64_t MakeAPIGet(std::string&& apiUrl, std::string&& ifNoneMatch) {
+    if(!s_engine) throw std::runtime_error("API not initialized.");
+    return s_engine->submitGet(std::string(BASE_API_URL) + "/api" + apiUrl, std::move(ifNoneMatch));
+}
+
+uint64_t FetchAccount(std::string&& apiUrl, std::string&& ifNoneMatch) {
+    if(!s_engine) throw std::runtime_error("API not initialized.");
+    return s_engine->fetchAccount(std::string(BASE_API_URL) + "/api" + apiUrl, std::move(ifNoneMatch));
+}
+
+uint64_t OpenAPIStream(std::string&& apiUrl) {
+    if(!s_engine) throw std::runtime_error("API not initialized.");
+    return s_engine->openStream(std::string(BASE_API_URL) + "/api" + apiUrl);
+}
+
+void CancelAPICall(uint64_t id) {
+    if(s_engine) s_engine->cancel(id);
+}
+
+void WarmUpAPI() {
+    if(s_engine) s_engine->warmUp(std::string(BASE_API_URL) + "/api/version");
+}
+
+bool PollAPI(APIResponse& response) {
+    return s_engine && s_engine->poll(response);
+}
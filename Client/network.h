@@ -0,0 +1,135 @@
+#pragma once
+
+/* Standard headers */
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "responses.h"
+
+#define BASE_API_URL "http://127.0.0.1"
+#define BASE_API_PORT 5540
+
+/* API implementation */
+
+/**
+ * Where the time of one API call went, in microseconds
+ * Phases in order: waiting on the worker, DNS, TCP connect, TLS handshake, then from the request
+ * going out to the first byte back (server time plus a round trip). total is curl's whole transfer
+ * time, the phases without queue add up to at most that. parse is spent decoding the body, on the
+ * worker while it downloads or on the render thread afterwards
+ */
+struct RequestTiming {
+    uint64_t queue{};
+    uint64_t dns{};
+    uint64_t connect{};
+    uint64_t tls{};
+    uint64_t firstByte{};
+    uint64_t total{};
+    uint64_t parse{};
+};
+
+/**
+ * A completed API call, as handed from the network worker to the render loop
+ */
+struct APIResponse {
+    uint64_t id{};
+    bool success{};
+    std::string body{};
+    long status{};          // HTTP status, 0 if the transfer failed
+    std::string etag{};     // ETag header, if the server sent one
+    bool partial{};         // a stream event, more responses with this id follow
+    std::unique_ptr<Response> decoded{};    // FetchAccount() result, decoded instead of kept in body
+    RequestTiming timing{};                 // not filled for stream events
+};
+
+/**
+ * Start the network worker
+ * One long-lived thread drives a curl_multi handle for every API call, so requests
+ * share connections and no thread is created per call.
+ * Must be called after curl_global_init()
+ * @param wake Called from the worker thread after a response was queued (may be nullptr)
+ */
+void InitAPI(void (*wake)() = nullptr);
+
+/**
+ * Stop the network worker
+ * Pending calls are dropped. Must be called before curl_global_cleanup()
+ */
+void CloseAPI();
+
+/**
+ * Percent-encode a value for a form body or query string
+ * RFC 3986 unreserved characters pass through, everything else becomes %XX
+ * @param value Raw value
+ * @return Encoded value
+ */
+std::string URLEncode(std::string_view value);
+
+/**
+ * Append key=value to a form body or query string, the value percent-encoded in place
+ * @param form Form so far, gets a '&' first unless empty
+ * @param key Field name, used as is
+ * @param value Raw value
+ */
+void AppendFormField(std::string& form, std::string_view key, std::string_view value);
+
+/**
+ * Send a POST request to a URL
+ * @param apiUrl URL to send a request to
+ * @param postData The POST data (format "key=value&key1=value1...")
+ * @return Request id, reported back by PollAPI() once the call completes
+ */
+uint64_t MakeAPICall(std::string&& apiUrl, std::string&& postData);
+
+/**
+ * Send a GET request to a URL
+ * @param apiUrl URL to send a request to, including the query string
+ * @param ifNoneMatch ETag of the copy the caller holds. A 304 response (empty body) means it is still current
+ * @return Request id, reported back by PollAPI() once the call completes
+ */
+uint64_t MakeAPIGet(std::string&& apiUrl, std::string&& ifNoneMatch = std::string());
+
+/**
+ * Send a GET request for an /account response and decode it while it downloads
+ * Track records are parsed chunk by chunk on the network worker, the body is never buffered.
+ * The response carries the result in decoded (body stays empty), or an error message in body
+ * @param apiUrl URL to send a request to, including the query string
+ * @param ifNoneMatch ETag of the copy the caller holds. A 304 response has nothing decoded
+ * @return Request id, reported back by PollAPI() once the call completes
+ */
+uint64_t FetchAccount(std::string&& apiUrl, std::string&& ifNoneMatch);
+
+/**
+ * Open a Server-Sent Events stream
+ * The network worker keeps the connection open and reports every event through PollAPI() as it
+ * arrives, with partial set and the event data as body. A last response without partial reports
+ * that the stream ended (success is false if it broke)
+ * @param apiUrl URL to stream from, including the query string
+ * @return Request id shared by all events of the stream
+ */
+uint64_t OpenAPIStream(std::string&& apiUrl);
+
+/**
+ * Abort a request, or close a stream, without reporting anything more for it
+ * The transfer is cut off on the network worker right away. A response PollAPI() already
+ * holds still comes out, callers drop ids they no longer track
+ * @param id Request id
+ */
+void CancelAPICall(uint64_t id);
+
+/**
+ * Resolve and connect to the API server ahead of the first call
+ * Sends a cheap GET whose response is dropped, so the connection (and the DNS entry and TLS
+ * session) is cached by the time the user submits something. Nothing is reported to PollAPI()
+ */
+void WarmUpAPI();
+
+/**
+ * Take the next completed API call
+ * Must only be called from one thread (the render loop)
+ * @param response Receives {id, success, message}
+ * @return Boolean for whether a response was available
+ */
+bool PollAPI(APIResponse& response);
@@ -0,0 +1,55 @@
+/* Standard headers */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "profiler.h"
+
+/* Method definitions */
+
+size_t FrameProfiler::zone(const char* name) {
+    // Several places may time the same zone
+    for(size_t i = 0; i < m_zoneCount; i++)
+        if(strcmp(m_names[i], name) == 0) return i;
+    if(m_zoneCount == MAX_ZONES) return MAX_ZONES;
+    m_names[m_zoneCount] = name;
+    return m_zoneCount++;
+}
+
+void FrameProfiler::beginFrame() {
+    m_current.fill(0U);
+    m_frameStart = std::chrono::steady_clock::now();
+}
+
+void FrameProfiler::endFrame() {
+    m_frameTimes[m_next] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_frameStart).count();
+    m_zoneTimes[m_next] = m_current;
+    m_next = (m_next + 1U) % FRAMES;
+    m_frames = std::min(m_frames + 1U, FRAMES);
+}
+
+uint64_t FrameProfiler::framePercentile(double p) const {
+    std::array<uint64_t, FRAMES> values;
+    std::copy_n(m_frameTimes.begin(), FRAMES, values.begin());
+    // Unfilled slots are all at the end of the ring until it wraps
+    return percentile(values.data(), m_frames, p);
+}
+
+uint64_t FrameProfiler::zonePercentile(size_t zone, double p) const {
+    std::array<uint64_t, FRAMES> values;
+    for(size_t i = 0; i < m_frames; i++) values[i] = m_zoneTimes[i][zone];
+    return percentile(values.data(), m_frames, p);
+}
+
+uint64_t FrameProfiler::percentile(uint64_t* values, size_t count, double p) {
+    if(count == 0U) return 0U;
+    size_t rank = static_cast<size_t>(std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * count));
+    size_t index = rank > 0U ? rank - 1U : 0U;
+    std::nth_element(values, values + index, values + count);
+    return values[index];
+}
+
+FrameProfiler& Profiler() {
+    static FrameProfiler profiler;
+    return profiler;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+/* Standard headers */
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Debug builds always profile, release builds only with TIMETRACKER_PROFILER
+#if !defined(NDEBUG) || defined(TIMETRACKER_PROFILER)
+#define TIMETRACKER_PROFILING 1
+#endif
+
+/* Frame profiler */
+
+/**
+ * Times named zones of the render loop over the last FRAMES frames (render loop only)
+ * Zones are registered once and then timed by ProfileScope, which costs two clock reads.
+ * A zone entered more than once in a frame adds up.
+ */
+class FrameProfiler {
+public:
+    static constexpr size_t FRAMES = 240;       // 8s at 30fps
+    static constexpr size_t MAX_ZONES = 16;
+
+    /**
+     * Register a zone, or look up one registered under the same name
+     * @param name Zone name, must outlive the profiler (a string literal)
+     * @return Zone index, MAX_ZONES if there is no room left (not timed)
+     */
+    size_t zone(const char* name);
+
+    /**
+     * Start timing a frame, whatever was timed since the last endFrame() is dropped
+     */
+    void beginFrame();
+
+    /**
+     * Finish the frame and keep it in the ring
+     */
+    void endFrame();
+
+    /**
+     * Add time to a zone of the current frame
+     * @param zone Zone index
+     * @param ns Nanoseconds
+     */
+    void add(size_t zone, uint64_t ns) {
+        if(zone < MAX_ZONES) m_current[zone] += ns;
+    }
+
+    /**
+     * @return Number of frames kept, up to FRAMES
+     */
+    size_t frames() const { return m_frames; }
+
+    /**
+     * @param age 0 for the last finished frame, up to frames() - 1
+     * @return Its time from beginFrame() to endFrame() in nanoseconds
+     */
+    uint64_t frameTime(size_t age) const { return m_frameTimes[(m_next + FRAMES - 1U - age) % FRAMES]; }
+
+    /**
+     * @param p Percentile, 0 to 100
+     * @return Frame time at the percentile over the kept frames, in nanoseconds
+     */
+    uint64_t framePercentile(double p) const;
+
+    /**
+     * @param zone Zone index
+     * @param p Percentile, 0 to 100
+     * @return Time of the zone at the percentile over the kept frames, in nanoseconds
+     */
+    uint64_t zonePercentile(size_t zone, double p) const;
+
+    size_t zones() const { return m_zoneCount; }
+    const char* zoneName(size_t zone) const { return m_names[zone]; }
+
+private:
+    std::array<const char*, MAX_ZONES> m_names{};
+    size_t m_zoneCount{};
+
+    std::chrono::steady_clock::time_point m_frameStart{};
+    std::array<uint64_t, MAX_ZONES> m_current{};
+
+    // ring of finished frames
+    std::array<uint64_t, FRAMES> m_frameTimes{};
+    std::array<std::array<uint64_t, MAX_ZONES>, FRAMES> m_zoneTimes{};
+    size_t m_next{};
+    size_t m_frames{};
+
+    /**
+     * @param values Frame or zone times, reordered
+     * @param count Number of values
+     * @param p Percentile, 0 to 100
+     * @return Value at the percentile
+     */
+    static uint64_t percentile(uint64_t* values, size_t count, double p);
+};
+
+/**
+ * @return The render loop's profiler
+ */
+FrameProfiler& Profiler();
+
+/**
+ * Adds the time until it goes out of scope to a zone
+ */
+class ProfileScope {
+public:
+    explicit ProfileScope(size_t zone) : m_zone(zone), m_start(std::chrono::steady_clock::now()) {}
+    ~ProfileScope() {
+        Profiler().add(m_zone, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    size_t m_zone;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef TIMETRACKER_PROFILING
+/**
+ * Time the rest of the enclosing block as a zone, e.g. PROFILE_ZONE("picker");
+ */
+#define PROFILE_ZONE(name) \
+    static const size_t PROFILE_CONCAT(profileZone, __LINE__) = Profiler().zone(name); \
+    ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileZone, __LINE__))
+#define PROFILE_BEGIN_FRAME() Profiler().beginFrame()
+#define PROFILE_END_FRAME() Profiler().endFrame()
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_BEGIN_FRAME() ((void)0)
+#define PROFILE_END_FRAME() ((void)0)
+#endif
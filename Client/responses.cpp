@@ -0,0 +1,221 @@
+/* Standard headers */
+#include <charconv>
+
+#include "account_cache.h" // HashFNV1a
+#include "responses.h"
+
+/* Tag tables */
+
+namespace {
+
+constexpr TagTable<Behavior, 7> BEHAVIORS({
+    {"VERSION", Behavior::Version},
+    {"AUTHENTICATION", Behavior::Authentication},
+    {"ACCOUNT", Behavior::Account},
+    {"CHANGES", Behavior::Changes},
+    {"SAVEACK", Behavior::SaveAck},
+    {"SESSIONACK", Behavior::SessionAck},
+    {"TRACKINFO", Behavior::TrackInfo}
+}, Behavior::Unknown);
+
+constexpr TagTable<ChangeKind, 4> CHANGE_KINDS({
+    {"insert", ChangeKind::Insert},
+    {"delete", ChangeKind::Delete},
+    {"rename", ChangeKind::Rename},
+    {"seconds", ChangeKind::Seconds}
+}, ChangeKind::Unknown);
+
+} // namespace
+
+/* Method definitions */
+
+void Response::clear() {
+    behavior = Behavior::None;
+    hasError = hasMessage = hasUserid = hasSeconds = hasTracks = reset = false;
+    error.clear();
+    message.clear();
+    username.clear();
+    track.clear();
+    etag.clear();
+    name.clear();
+    description.clear();
+    version.clear();
+    userid = seq = seconds = 0U;
+    tracks.clear();
+    changes.clear();
+    ids.clear();
+    failed.clear();
+    bodyHash = FNV1A_OFFSET;
+}
+
+ResponseDecoder::ResponseDecoder() : m_parser(*this) {
+    begin();
+}
+
+bool ResponseDecoder::decode(std::string_view body) {
+    begin();
+    return feed(body) && finish();
+}
+
+void ResponseDecoder::begin() {
+    m_parser.reset();
+    m_response.clear();
+    m_depth = 0;
+    m_field = Field::None;
+    m_list = List::None;
+    m_inRecord = false;
+}
+
+bool ResponseDecoder::feed(std::string_view chunk) {
+    m_response.bodyHash = HashFNV1a(chunk, m_response.bodyHash);
+    return m_parser.feed(chunk);
+}
+
+bool ResponseDecoder::finish() {
+    return m_parser.finish();
+}
+
+void ResponseDecoder::beginObject() {
+    m_depth++;
+    if(m_depth != 3) return;
+
+    // Start a record, reusing one a previous response left behind
+    if(m_list == List::Tracks) {
+        TrackEntry& track = m_response.tracks.next();
+        track.name.clear();
+        track.seconds = 0U;
+        m_named = false;
+    } else if(m_list == List::Changes) {
+        TrackChange& change = m_response.changes.next();
+        change.seq = 0U;
+        change.kind = ChangeKind::Unknown;
+        change.track.clear();
+        change.name.clear();
+        change.seconds = 0U;
+    }
+    m_inRecord = m_list == List::Tracks || m_list == List::Changes;
+}
+
+void ResponseDecoder::endObject() {
+    // Track records without a name are skipped, like the server skips them
+    if(m_depth == 3 && m_inRecord && m_list == List::Tracks && !m_named) m_response.tracks.pop();
+    if(m_depth == 3) m_inRecord = false;
+    m_depth--;
+    m_field = Field::None;
+}
+
+void ResponseDecoder::beginArray() {
+    m_depth++;
+    if(m_depth != 2) return;
+
+    if(m_field == Field::Tracks) {
+        m_list = List::Tracks;
+        m_response.hasTracks = true;
+    } else if(m_field == Field::Changes) m_list = List::Changes;
+    else if(m_field == Field::Ids) m_list = List::Ids;
+    else if(m_field == Field::Failed) m_list = List::Failed;
+}
+
+void ResponseDecoder::endArray() {
+    m_depth--;
+    if(m_depth == 1) m_list = List::None;
+    m_field = Field::None;
+}
+
+void ResponseDecoder::key(std::string_view name) {
+    static constexpr TagTable<Field, 19> FIELDS({
+        {"behavior", Field::Behavior},
+        {"error", Field::Error},
+        {"message", Field::Message},
+        {"username", Field::Username},
+        {"uid", Field::Userid},
+        {"userId", Field::Userid},
+        {"seq", Field::Seq},
+        {"reset", Field::Reset},
+        {"etag", Field::Etag},
+        {"track", Field::Track},
+        {"seconds", Field::Seconds},
+        {"name", Field::Name},
+        {"description", Field::Description},
+        {"version", Field::Version},
+        {"kind", Field::Kind},
+        {"tracks", Field::Tracks},
+        {"changes", Field::Changes},
+        {"ids", Field::Ids},
+        {"failed", Field::Failed}
+    }, Field::None);
+
+    // Members of nested objects other than list records are of no interest
+    m_field = m_depth == 1 || (m_depth == 3 && m_inRecord) ? FIELDS.find(name) : Field::None;
+}
+
+void ResponseDecoder::string(std::string_view value) {
+    Response& response = m_response;
+
+    if(m_depth == 1) {
+        switch(m_field) {
+            case Field::Behavior: response.behavior = BEHAVIORS.find(value); break;
+            case Field::Error:
+                response.error.assign(value);
+                response.hasError = true;
+                break;
+            case Field::Message:
+                response.message.assign(value);
+                response.hasMessage = true;
+                break;
+            case Field::Username: response.username.assign(value); break;
+            case Field::Etag: response.etag.assign(value); break;
+            case Field::Track: response.track.assign(value); break;
+            case Field::Name: response.name.assign(value); break;
+            case Field::Description: response.description.assign(value); break;
+            case Field::Version: response.version.assign(value); break;
+            default: break;
+        }
+    } else if(m_depth == 2 && (m_list == List::Ids || m_list == List::Failed)) {
+        uint64_t id = 0;
+        std::from_chars(value.data(), value.data() + value.size(), id, 16);
+        (m_list == List::Ids ? response.ids : response.failed).push_back(id);
+    } else if(m_depth == 3 && m_inRecord && m_list == List::Tracks && m_field == Field::Track) {
+        TrackEntry& track = response.tracks[response.tracks.size() - 1];
+        track.name.assign(value);
+        m_named = true;
+    } else if(m_depth == 3 && m_inRecord && m_list == List::Changes) {
+        TrackChange& change = response.changes[response.changes.size() - 1];
+        if(m_field == Field::Kind) change.kind = CHANGE_KINDS.find(value);
+        else if(m_field == Field::Track) change.track.assign(value);
+        else if(m_field == Field::Name) change.name.assign(value);
+    }
+    m_field = Field::None;
+}
+
+void ResponseDecoder::number(std::string_view text) {
+    uint64_t value = 0;
+    std::from_chars(text.data(), text.data() + text.size(), value); // stops at a fraction, leaves 0 for negatives
+
+    if(m_depth == 1) {
+        switch(m_field) {
+            case Field::Userid:
+                m_response.userid = value;
+                m_response.hasUserid = true;
+                break;
+            case Field::Seq: m_response.seq = value; break;
+            case Field::Seconds:
+                m_response.seconds = value;
+                m_response.hasSeconds = true;
+                break;
+            default: break;
+        }
+    } else if(m_depth == 3 && m_inRecord && m_list == List::Tracks && m_field == Field::Seconds) {
+        m_response.tracks[m_response.tracks.size() - 1].seconds = value;
+    } else if(m_depth == 3 && m_inRecord && m_list == List::Changes) {
+        TrackChange& change = m_response.changes[m_response.changes.size() - 1];
+        if(m_field == Field::Seq) change.seq = value;
+        else if(m_field == Field::Seconds) change.seconds = value;
+    }
+    m_field = Field::None;
+}
+
+void ResponseDecoder::boolean(bool value) {
+    if(m_depth == 1 && m_field == Field::Reset) m_response.reset = value;
+    m_field = Field::None;
+}
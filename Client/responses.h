@@ -0,0 +1,258 @@
+#pragma once
+
+/* Standard headers */
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "json_stream.h"
+
+/* Decoded API responses */
+
+/**
+ * The "behavior" tag of a response, None for plain message / error responses
+ */
+enum class Behavior : uint8_t {
+    None,
+    Version,
+    Authentication,
+    Account,
+    Changes,
+    SaveAck,
+    SessionAck,
+    TrackInfo,
+    Unknown
+};
+
+enum class ChangeKind : uint8_t {
+    Unknown,
+    Insert,
+    Delete,
+    Rename,
+    Seconds
+};
+
+/**
+ * One {track, seconds} record (/account tracks, /sessions totals)
+ */
+struct TrackEntry {
+    std::string name{};
+    uint64_t seconds{};
+};
+
+/**
+ * One entry of a CHANGES payload
+ */
+struct TrackChange {
+    uint64_t seq{};
+    ChangeKind kind{};
+    std::string track{};
+    std::string name{};     // rename target
+    uint64_t seconds{};
+};
+
+/**
+ * Vector whose elements outlive clear(), so their strings keep their capacity for the next response
+ * @tparam T Element type
+ */
+template<typename T>
+class ReusedList {
+public:
+    /**
+     * Append an element, reusing a cleared one if there is one
+     * @return The element, with whatever a previous response left in it
+     */
+    T& next() {
+        if(m_size == m_items.size()) m_items.emplace_back();
+        return m_items[m_size++];
+    }
+
+    /**
+     * Drop the last element again
+     */
+    void pop() { m_size--; }
+
+    void clear() { m_size = 0; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    T& operator[](size_t i) { return m_items[i]; }
+    const T& operator[](size_t i) const { return m_items[i]; }
+    T* begin() { return m_items.data(); }
+    T* end() { return m_items.data() + m_size; }
+    const T* begin() const { return m_items.data(); }
+    const T* end() const { return m_items.data() + m_size; }
+
+private:
+    std::vector<T> m_items;
+    size_t m_size = 0;
+};
+
+/**
+ * Any API response. Members a response does not have are left empty / zero
+ */
+struct Response {
+    Behavior behavior{};
+    bool hasError{};
+    bool hasMessage{};
+    bool hasUserid{};
+    bool hasSeconds{};
+    bool hasTracks{};
+    bool reset{};                   // CHANGES: too far behind, reload the account
+    std::string error{};
+    std::string message{};
+    std::string username{};         // AUTHENTICATION, ACCOUNT
+    std::string track{};            // TRACKINFO
+    std::string etag{};             // CHANGES
+    std::string name{};             // VERSION
+    std::string description{};
+    std::string version{};
+    uint64_t userid{};              // "uid" or "userId"
+    uint64_t seq{};                 // ACCOUNT, CHANGES
+    uint64_t seconds{};             // TRACKINFO
+    ReusedList<TrackEntry> tracks{};        // ACCOUNT, SESSIONACK
+    ReusedList<TrackChange> changes{};      // CHANGES
+    std::vector<uint64_t> ids{};            // SESSIONACK, journal entry ids
+    std::vector<uint64_t> failed{};         // SESSIONACK, ids the server could not store
+    uint64_t bodyHash{};            // HashFNV1a of the raw body, a version stamp for servers without ETags
+
+    /**
+     * Empty every member, keeping the memory
+     */
+    void clear();
+};
+
+/**
+ * Compile-time perfect hash from a fixed set of strings to values
+ * The constructor searches a seed for which no two strings share a slot, so a lookup is one hash
+ * and one comparison. Declare instances constexpr, a set without a seed then fails to compile.
+ * @tparam E Value type
+ * @tparam N Number of strings
+ */
+template<typename E, size_t N>
+class TagTable {
+public:
+    consteval TagTable(const std::pair<std::string_view, E> (&tags)[N], E missing) : m_missing(missing) {
+        for(uint32_t seed = 0; seed < 100000; seed++) {
+            m_slots = {};
+            bool perfect = true;
+            for(const auto& tag : tags) {
+                auto& slot = m_slots[hash(tag.first, seed) & (SLOTS - 1)];
+                if(!slot.first.empty()) {
+                    perfect = false;
+                    break;
+                }
+                slot = tag;
+            }
+            if(perfect) {
+                m_seed = seed;
+                return;
+            }
+        }
+        throw std::logic_error("No perfect hash seed for these tags.");
+    }
+
+    /**
+     * @param tag String to look up
+     * @return Its value, or the missing value
+     */
+    constexpr E find(std::string_view tag) const {
+        const auto& slot = m_slots[hash(tag, m_seed) & (SLOTS - 1)];
+        return !tag.empty() && slot.first == tag ? slot.second : m_missing;
+    }
+
+private:
+    static constexpr size_t SLOTS = std::bit_ceil(N * 4);
+
+    std::array<std::pair<std::string_view, E>, SLOTS> m_slots{};
+    uint32_t m_seed = 0;
+    E m_missing;
+
+    // 32-bit FNV-1a, the seed perturbs the offset basis
+    static constexpr uint32_t hash(std::string_view tag, uint32_t seed) {
+        uint32_t h = 2166136261U ^ (seed * 0x9E3779B9U);
+        for(char c : tag) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 16777619U;
+        }
+        return h;
+    }
+};
+
+/**
+ * Decodes response bodies into a Response, straight from the JSON tokens
+ * Meant to be kept around: the Response and the parser buffers are reused, so decoding a
+ * response no bigger than earlier ones does not allocate. Bodies can be decoded whole or fed in pieces.
+ */
+class ResponseDecoder : private JsonHandler {
+public:
+    ResponseDecoder();
+
+    ResponseDecoder(const ResponseDecoder&) = delete;
+    ResponseDecoder& operator=(const ResponseDecoder&) = delete;
+
+    /**
+     * Decode a whole body
+     * @param body Response body
+     * @return Boolean for whether it was a valid JSON document (see error())
+     */
+    bool decode(std::string_view body);
+
+    /**
+     * Start decoding a body that arrives in pieces
+     */
+    void begin();
+
+    /**
+     * Decode the next piece of the body
+     * @param chunk Bytes as received
+     * @return Boolean for whether the body is still valid
+     */
+    bool feed(std::string_view chunk);
+
+    /**
+     * End of the body
+     * @return Boolean for whether a complete document was decoded
+     */
+    bool finish();
+
+    /**
+     * @return Description of the first parse error
+     */
+    const std::string& error() const { return m_parser.error(); }
+
+    /**
+     * @return The response decoded last (or so far)
+     */
+    Response& response() { return m_response; }
+
+private:
+    enum class Field : uint8_t {
+        None, Behavior, Error, Message, Username, Userid, Seq, Reset, Etag, Track, Seconds,
+        Name, Description, Version, Kind, Tracks, Changes, Ids, Failed
+    };
+
+    // Lists of records, selected by the member holding them
+    enum class List : uint8_t { None, Tracks, Changes, Ids, Failed };
+
+    JsonStreamParser m_parser;
+    Response m_response{};
+    int m_depth = 0;                // 1 in the response object, 2 in a list, 3 in a record of the list
+    Field m_field = Field::None;    // member whose value comes next
+    List m_list = List::None;
+    bool m_named = false;           // the current track record has a name
+    bool m_inRecord = false;        // a record of m_list was started at depth 3
+
+    void beginObject() override;
+    void endObject() override;
+    void beginArray() override;
+    void endArray() override;
+    void key(std::string_view name) override;
+    void string(std::string_view value) override;
+    void number(std::string_view text) override;
+    void boolean(bool value) override;
+};
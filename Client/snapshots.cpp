@@ -0,0 +1,139 @@
+/* Standard headers */
+#include <chrono>
+#include <cstdio>
+#include <utility>
+
+#include "snapshots.h"
+#include "trace.h"
+
+/* Method definitions */
+
+SnapshotBuilder::SnapshotBuilder(void (*wake)()) : m_wake(wake) {
+    m_worker = std::thread(&SnapshotBuilder::run, this);
+}
+
+SnapshotBuilder::~SnapshotBuilder() {
+    stop();
+}
+
+void SnapshotBuilder::stop() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_one();
+    if(m_worker.joinable()) m_worker.join();
+}
+
+uint64_t SnapshotBuilder::build(const CachedAccount& owner, std::string&& stamp, std::unique_ptr<Response> account, const std::string& cachePath) {
+    uint64_t id = m_nextId++;
+    {
+        std::lock_guard lock(m_mutex);
+        m_jobs.push_back(Job {id, owner, std::move(stamp), std::move(account), cachePath});
+    }
+    m_cv.notify_one();
+    return id;
+}
+
+bool SnapshotBuilder::poll(std::unique_ptr<TrackSnapshot>& snapshot) {
+    if(!m_ready.load(std::memory_order_acquire)) return false;
+
+    std::lock_guard lock(m_mutex);
+    if(m_finished.empty()) return false;
+    snapshot = std::move(m_finished.front());
+    m_finished.erase(m_finished.begin());
+    m_ready.store(!m_finished.empty(), std::memory_order_release);
+    return true;
+}
+
+void SnapshotBuilder::retire(std::unique_ptr<TrackSnapshot> snapshot) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_retired.push_back(std::move(snapshot));
+    }
+    m_cv.notify_one();
+}
+
+void SnapshotBuilder::save(const std::string& path, std::string&& image) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_savePath = path;
+        m_saveImage = std::move(image);
+    }
+    m_cv.notify_one();
+}
+
+void SnapshotBuilder::run() {
+    TraceThreadName("snapshots");
+    std::vector<Job> jobs;
+    std::vector<std::unique_ptr<TrackSnapshot>> retired;
+    std::string savePath, saveImage;
+
+    // Write the queued cache image, if any (called and returns with the lock held)
+    auto writeCache = [&](std::unique_lock<std::mutex>& lock) {
+        if(m_saveImage.empty()) return;
+        savePath = m_savePath;
+        saveImage.swap(m_saveImage);
+        m_saveImage.clear();
+        lock.unlock();
+
+        TraceScope trace("write cache");
+        if(!WriteAccountCache(savePath, saveImage))
+            fprintf(stderr, "Could not write the account cache to %s\n", savePath.c_str());
+        lock.lock();
+    };
+
+    std::unique_lock lock(m_mutex);
+    while(true) {
+        m_cv.wait(lock, [this] { return m_stop || !m_jobs.empty() || !m_retired.empty() || !m_saveImage.empty(); });
+        if(m_stop) break;
+
+        writeCache(lock);
+        jobs.swap(m_jobs);
+        retired.swap(m_retired);
+        lock.unlock();
+
+        if(!retired.empty()) {
+            TraceScope trace("free tracks");
+            retired.clear(); // the expensive part of letting go of a large list
+        }
+
+        // The render loop only takes the latest build, older ones still queued are superseded
+        if(!jobs.empty()) {
+            TraceScope trace("build tracks");
+            Job& job = jobs.back();
+            auto snapshot = std::make_unique<TrackSnapshot>();
+            snapshot->id = job.id;
+            snapshot->userid = job.owner.userid;
+            snapshot->seq = job.account->seq;
+            snapshot->stamp = std::move(job.stamp);
+
+            // Keep the seconds as well, so picking a track shows them right away
+            auto now = std::chrono::system_clock::now();
+            for(TrackEntry& track : job.account->tracks) snapshot->tracks.insert(std::move(track.name), track.seconds, now);
+
+            // Cache the list as built, the render loop then has nothing to encode when it swaps it in
+            if(!job.cachePath.empty()) {
+                TraceScope save("write cache");
+                job.owner.stamp = snapshot->stamp;
+                job.owner.seq = snapshot->seq;
+                EncodeAccountCache(job.owner, snapshot->tracks, saveImage);
+                if(!WriteAccountCache(job.cachePath, saveImage))
+                    fprintf(stderr, "Could not write the account cache to %s\n", job.cachePath.c_str());
+            }
+
+            {
+                std::lock_guard done(m_mutex);
+                m_finished.push_back(std::move(snapshot));
+                m_ready.store(true, std::memory_order_release);
+            }
+            if(m_wake != nullptr) m_wake();
+        }
+        jobs.clear(); // frees the responses here as well
+
+        lock.lock();
+    }
+
+    // The last save holds the state at shutdown
+    writeCache(lock);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+/* Standard headers */
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "account_cache.h"
+#include "responses.h"
+#include "tracks.h"
+
+/* Track list snapshots */
+
+/**
+ * A track list built off the render thread, ready to be swapped in
+ */
+struct TrackSnapshot {
+    uint64_t id{};          // build() request it answers
+    uint64_t userid{};
+    uint64_t seq{};         // change feed position of the list
+    std::string stamp{};    // version stamp of the list
+    TrackTable tracks{};
+};
+
+/**
+ * Builds track tables from /account responses on a worker thread
+ * The render loop hands in decoded responses and takes finished snapshots back, which it swaps in
+ * with TrackTable::swap(). The table swapped out goes back through retire() to be freed here too,
+ * so neither building nor tearing down a large list costs frame time. The worker also writes the
+ * account cache: built lists straight away, other changes from images the render loop encodes.
+ */
+class SnapshotBuilder {
+public:
+    /**
+     * Start the worker
+     * @param wake Called from the worker thread after a snapshot is ready (may be nullptr)
+     */
+    explicit SnapshotBuilder(void (*wake)() = nullptr);
+    ~SnapshotBuilder();
+
+    /**
+     * Write the queued cache save, if any, and join the worker. Nothing queued afterwards is handled
+     */
+    void stop();
+
+    SnapshotBuilder(const SnapshotBuilder&) = delete;
+    SnapshotBuilder& operator=(const SnapshotBuilder&) = delete;
+
+    /**
+     * Queue a track table build
+     * @param owner Account of the tracks
+     * @param stamp Version stamp of the response
+     * @param account Decoded /account response, its track names are moved out
+     * @param cachePath Where to save the built list as owner's account cache, empty for nowhere
+     * @return Id of the snapshot that will answer this
+     */
+    uint64_t build(const CachedAccount& owner, std::string&& stamp, std::unique_ptr<Response> account, const std::string& cachePath = std::string());
+
+    /**
+     * Take the next finished snapshot (render loop only)
+     * @param snapshot Receives the snapshot
+     * @return Boolean for whether one was ready
+     */
+    bool poll(std::unique_ptr<TrackSnapshot>& snapshot);
+
+    /**
+     * Hand back a snapshot (holding the table it replaced, or one that was never used) to be freed on the worker
+     * @param snapshot The snapshot
+     */
+    void retire(std::unique_ptr<TrackSnapshot> snapshot);
+
+    /**
+     * Queue an account cache write (see EncodeAccountCache()), replacing one not written yet
+     * A save still queued when the builder is stopped is written before the worker ends.
+     * @param path Cache file path
+     * @param image The encoded cache
+     */
+    void save(const std::string& path, std::string&& image);
+
+private:
+    struct Job {
+        uint64_t id{};
+        CachedAccount owner{};
+        std::string stamp{};
+        std::unique_ptr<Response> account{};
+        std::string cachePath{};
+    };
+
+    void (*m_wake)() = nullptr;
+    std::thread m_worker;
+    uint64_t m_nextId = 1;          // render loop only
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<Job> m_jobs;
+    std::vector<std::unique_ptr<TrackSnapshot>> m_retired;
+    std::vector<std::unique_ptr<TrackSnapshot>> m_finished;
+    std::string m_savePath;
+    std::string m_saveImage;                // latest cache image not written yet, empty if none
+    std::atomic<bool> m_ready = false;     // m_finished is not empty, checked without the lock every frame
+    bool m_stop = false;
+
+    /**
+     * Worker loop: free retired tables, build queued ones, write the cache
+     */
+    void run();
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+/* Standard headers */
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/**
+ * Bounded lock-free single-producer / single-consumer ring buffer
+ * Exactly one thread may push() and exactly one (other) thread may pop().
+ * @tparam T Element type, must be default constructible and movable
+ * @tparam Capacity Number of slots, must be a power of two
+ */
+template<typename T, size_t Capacity>
+class SPSCQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SPSCQueue capacity must be a power of two.");
+
+public:
+    SPSCQueue() = default;
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    /**
+     * Producer: append an element
+     * @param value Element to move into the queue
+     * @return Boolean for whether there was room (value is untouched if not)
+     */
+    bool push(T&& value) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if(tail - m_headCache == Capacity) {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if(tail - m_headCache == Capacity) return false;
+        }
+
+        m_slots[tail & (Capacity - 1)] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Consumer: take the oldest element
+     * @param value Receives the element
+     * @return Boolean for whether an element was available
+     */
+    bool pop(T& value) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if(head == m_tailCache) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if(head == m_tailCache) return false;
+        }
+
+        value = std::move(m_slots[head & (Capacity - 1)]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Consumer: check for pending elements without taking one
+     * @return Boolean for whether the queue looked empty
+     */
+    bool empty() const {
+        return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t CacheLine = 64;
+
+    // consumer side
+    alignas(CacheLine) std::atomic<size_t> m_head = 0;
+    size_t m_tailCache = 0;
+
+    // producer side
+    alignas(CacheLine) std::atomic<size_t> m_tail = 0;
+    size_t m_headCache = 0;
+
+    alignas(CacheLine) std::array<T, Capacity> m_slots{};
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+/* Standard headers */
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/* Allocation-free time formatting */
+
+/**
+ * Buffer size that fits any formatted uint64_t value or duration, including the NUL
+ * (the longest is 18446744073709551615 seconds: "5124095576030431:00:15")
+ */
+constexpr size_t HMS_BUFFER_SIZE = 24;
+
+namespace detail {
+
+/**
+ * "00" "01" ... "99" as one flat table, two characters per entry
+ */
+constexpr std::array<char, 200> MakeTwoDigitTable() {
+    std::array<char, 200> table{};
+    for(int i = 0; i < 100; i++) {
+        table[i * 2] = static_cast<char>('0' + i / 10);
+        table[i * 2 + 1] = static_cast<char>('0' + i % 10);
+    }
+    return table;
+}
+
+inline constexpr std::array<char, 200> TwoDigits = MakeTwoDigitTable();
+
+/**
+ * Write two zero-padded digits
+ * @param value 0 - 99
+ * @param buf Output (2 chars)
+ */
+constexpr void WriteTwoDigits(uint64_t value, char* buf) {
+    buf[0] = TwoDigits[value * 2];
+    buf[1] = TwoDigits[value * 2 + 1];
+}
+
+} // namespace detail
+
+/**
+ * Write an unsigned integer in decimal
+ * @param value Value to format
+ * @param buf Output buffer, at least HMS_BUFFER_SIZE bytes. Gets NUL-terminated
+ * @return Number of characters written (without the NUL)
+ */
+constexpr size_t FormatUInt(uint64_t value, char* buf) {
+    // Fill from the back two digits at a time, then move to the front
+    char tmp[HMS_BUFFER_SIZE];
+    char* end = tmp + sizeof(tmp);
+    char* p = end;
+    while(value >= 100) {
+        p -= 2;
+        detail::WriteTwoDigits(value % 100, p);
+        value /= 100;
+    }
+    if(value >= 10) {
+        p -= 2;
+        detail::WriteTwoDigits(value, p);
+    } else *--p = static_cast<char>('0' + value);
+
+    size_t length = static_cast<size_t>(end - p);
+    for(size_t i = 0; i < length; i++) buf[i] = p[i];
+    buf[length] = '\0';
+    return length;
+}
+
+/**
+ * Convert seconds to HHMMSS format without allocating
+ * Layout matches the picker and counter displays: "H:MM:SS", "M:SS" below an hour, "S" below a minute
+ * @param seconds Seconds
+ * @param buf Output buffer, at least HMS_BUFFER_SIZE bytes. Gets NUL-terminated
+ * @return Number of characters written (without the NUL)
+ */
+constexpr size_t FormatHMS(uint64_t seconds, char* buf) {
+    const uint64_t hh = seconds / 3600;
+    const uint64_t mm = (seconds / 60) % 60;
+    const uint64_t ss = seconds % 60;
+
+    if(hh > 0) {
+        // HH:MM:SS
+        size_t length = FormatUInt(hh, buf);
+        buf[length] = ':';
+        detail::WriteTwoDigits(mm, buf + length + 1);
+        buf[length + 3] = ':';
+        detail::WriteTwoDigits(ss, buf + length + 4);
+        buf[length + 6] = '\0';
+        return length + 6;
+    } else if(mm > 0) {
+        // MM:SS
+        size_t length = FormatUInt(mm, buf);
+        buf[length] = ':';
+        detail::WriteTwoDigits(ss, buf + length + 1);
+        buf[length + 3] = '\0';
+        return length + 3;
+    }
+
+    // SS
+    return FormatUInt(ss, buf);
+}
+
+/**
+ * Convert many durations at once, e.g. for a duration column
+ * Entry i is written NUL-terminated at out + i * stride
+ * @param seconds Durations to format
+ * @param count Number of durations
+ * @param out Output buffer of count * stride bytes
+ * @param stride Bytes per entry, at least HMS_BUFFER_SIZE
+ */
+constexpr void FormatHMSBulk(const uint64_t* seconds, size_t count, char* out, size_t stride) {
+    for(size_t i = 0; i < count; i++) FormatHMS(seconds[i], out + i * stride);
+}
@@ -0,0 +1,202 @@
+/* Standard headers */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "app_paths.h"
+#include "trace.h"
+
+/* Event buffers */
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    uint64_t time;          // ns since the trace started
+    uint64_t duration;      // ns, complete events only
+    uint64_t id;            // async events only
+    char phase;             // Chrome trace-event phase: X, i, b or e
+    char detail[31];        // NUL-terminated
+};
+
+/**
+ * Events of one thread, written only by it
+ */
+struct TraceBuffer {
+    static constexpr size_t CAPACITY = 1U << 15;   // 2 MiB per thread
+
+    std::unique_ptr<TraceEvent[]> events = std::make_unique<TraceEvent[]>(CAPACITY);
+    std::atomic<uint64_t> written{0};
+    uint32_t tid{};
+    const char* name{};
+};
+
+std::atomic<bool> s_enabled{false};
+std::chrono::steady_clock::time_point s_origin = std::chrono::steady_clock::now();
+std::string s_path;
+
+// Buffers live until exit, a thread that ended may still have events in one
+std::mutex s_buffersMutex;
+std::vector<std::unique_ptr<TraceBuffer>> s_buffers;
+
+thread_local TraceBuffer* t_buffer = nullptr;
+thread_local const char* t_name = nullptr;
+
+/**
+ * @return The calling thread's buffer, made on its first event
+ */
+TraceBuffer& ThreadBuffer() {
+    if(t_buffer == nullptr) {
+        std::lock_guard lock(s_buffersMutex);
+        auto buffer = std::make_unique<TraceBuffer>();
+        buffer->tid = static_cast<uint32_t>(s_buffers.size() + 1U);
+        buffer->name = t_name;
+        t_buffer = buffer.get();
+        s_buffers.push_back(std::move(buffer));
+    }
+    return *t_buffer;
+}
+
+void Record(char phase, const char* name, uint64_t time, uint64_t duration, uint64_t id, std::string_view detail) {
+    TraceBuffer& buffer = ThreadBuffer();
+    uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    TraceEvent& event = buffer.events[index % TraceBuffer::CAPACITY];
+    event.name = name;
+    event.time = time;
+    event.duration = duration;
+    event.id = id;
+    event.phase = phase;
+    size_t length = std::min(detail.size(), sizeof(event.detail) - 1U);
+    memcpy(event.detail, detail.data(), length);
+    event.detail[length] = '\0';
+    buffer.written.store(index + 1U, std::memory_order_release);
+}
+
+/**
+ * Append a string as a JSON string literal
+ * @param json Output
+ * @param value String to quote
+ */
+void AppendQuoted(std::string& json, const char* value) {
+    json += '"';
+    for(const char* c = value; *c != '\0'; c++) {
+        if(*c == '"' || *c == '\\') {
+            json += '\\';
+            json += *c;
+        } else if(static_cast<unsigned char>(*c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(*c));
+            json += escaped;
+        } else json += *c;
+    }
+    json += '"';
+}
+
+}
+
+/* Method definitions */
+
+void StartTrace(std::string path) {
+    s_path = std::move(path);
+    s_origin = std::chrono::steady_clock::now();
+    s_enabled.store(true, std::memory_order_release);
+}
+
+bool StopTrace() {
+    if(!s_enabled.exchange(false)) return false;
+    if(s_path.empty()) return false;
+
+    std::string json = R"({"displayTimeUnit":"ms","traceEvents":[)";
+    char field[160];
+    bool first = true;
+    auto separate = [&]() {
+        if(!first) json += ',';
+        first = false;
+    };
+
+    std::lock_guard lock(s_buffersMutex);
+    for(const auto& buffer : s_buffers) {
+        if(buffer->name != nullptr) {
+            separate();
+            snprintf(field, sizeof(field), R"({"name":"thread_name","ph":"M","pid":1,"tid":%u,"args":{"name":)", buffer->tid);
+            json += field;
+            AppendQuoted(json, buffer->name);
+            json += "}}";
+        }
+
+        // Once the ring wrapped only the newest CAPACITY events are left
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        for(uint64_t i = written > TraceBuffer::CAPACITY ? written - TraceBuffer::CAPACITY : 0U; i < written; i++) {
+            const TraceEvent& event = buffer->events[i % TraceBuffer::CAPACITY];
+            separate();
+            json += R"({"name":)";
+            AppendQuoted(json, event.name);
+            snprintf(field, sizeof(field), R"(,"cat":"client","ph":"%c","ts":%.3f,"pid":1,"tid":%u)", event.phase, event.time / 1000.0, buffer->tid);
+            json += field;
+            if(event.phase == 'X') {
+                snprintf(field, sizeof(field), R"(,"dur":%.3f)", event.duration / 1000.0);
+                json += field;
+            } else if(event.phase == 'i') {
+                json += R"(,"s":"t")";
+            } else {
+                snprintf(field, sizeof(field), R"(,"id":"0x%llx")", static_cast<unsigned long long>(event.id));
+                json += field;
+            }
+            if(event.detail[0] != '\0') {
+                json += R"(,"args":{"detail":)";
+                AppendQuoted(json, event.detail);
+                json += '}';
+            }
+            json += '}';
+        }
+    }
+    json += "]}\n";
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(s_path).parent_path(), error);
+    std::ofstream out(s_path, std::ios::binary | std::ios::trunc);
+    out.write(json.data(), static_cast<std::streamsize>(json.size()));
+    return static_cast<bool>(out);
+}
+
+bool TraceEnabled() {
+    return s_enabled.load(std::memory_order_relaxed);
+}
+
+std::string TracePath() {
+    return AppFilePath("trace.json", AppDir::Cache);
+}
+
+void TraceThreadName(const char* name) {
+    t_name = name;
+    if(t_buffer != nullptr) t_buffer->name = name;
+}
+
+uint64_t TraceNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_origin).count();
+}
+
+void TraceComplete(const char* name, uint64_t start, std::string_view detail) {
+    if(!TraceEnabled()) return;
+    uint64_t now = TraceNow();
+    Record('X', name, start, now > start ? now - start : 0U, 0U, detail);
+}
+
+void TraceInstant(const char* name, std::string_view detail) {
+    if(TraceEnabled()) Record('i', name, TraceNow(), 0U, 0U, detail);
+}
+
+void TraceAsyncBegin(const char* name, uint64_t id, std::string_view detail) {
+    if(TraceEnabled()) Record('b', name, TraceNow(), 0U, id, detail);
+}
+
+void TraceAsyncEnd(const char* name, uint64_t id, std::string_view detail) {
+    if(TraceEnabled()) Record('e', name, TraceNow(), 0U, id, detail);
+}
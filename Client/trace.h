@@ -0,0 +1,95 @@
+#pragma once
+
+/* Standard headers */
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/* Timeline tracing */
+
+/**
+ * Start recording trace events, until StopTrace()
+ * Every thread records into its own ring buffer (the newest events win once it is full), so
+ * recording takes no lock. Before this, and after StopTrace(), every Trace*() call is one branch.
+ * @param path Where StopTrace() writes the trace
+ */
+void StartTrace(std::string path);
+
+/**
+ * Stop recording and write everything recorded as Chrome trace-event JSON (opens in Perfetto and
+ * chrome://tracing). Call once the other recording threads are stopped or idle
+ * @return Boolean for whether the file was written
+ */
+bool StopTrace();
+
+/**
+ * @return Boolean for whether events are being recorded
+ */
+bool TraceEnabled();
+
+/**
+ * Where traces go by default: $XDG_CACHE_HOME (or ~/.cache) /timetracker/trace.json,
+ * %LOCALAPPDATA%\TimeTracker\trace.json on Windows
+ * @return Trace file path, empty if no suitable directory exists
+ */
+std::string TracePath();
+
+/**
+ * Name the calling thread in the trace
+ * @param name Thread name, a string literal
+ */
+void TraceThreadName(const char* name);
+
+/**
+ * @return Trace clock in nanoseconds, for TraceComplete()
+ */
+uint64_t TraceNow();
+
+/**
+ * Record a slice that started earlier and ends now
+ * @param name Event name, a string literal
+ * @param start Start from TraceNow()
+ * @param detail Shown as an argument, cut to 31 bytes
+ */
+void TraceComplete(const char* name, uint64_t start, std::string_view detail = {});
+
+/**
+ * Record a point in time, e.g. a state change
+ * @param name Event name, a string literal
+ * @param detail Shown as an argument, cut to 31 bytes
+ */
+void TraceInstant(const char* name, std::string_view detail = {});
+
+/**
+ * Record the start of something that ends later, possibly on another thread
+ * @param name Event name, a string literal, the same for the end
+ * @param id Tells concurrent ones apart, e.g. the request id
+ * @param detail Shown as an argument, cut to 31 bytes
+ */
+void TraceAsyncBegin(const char* name, uint64_t id, std::string_view detail = {});
+
+/**
+ * Record the end of something TraceAsyncBegin() started
+ * @param name Event name, as given to TraceAsyncBegin()
+ * @param id Its id
+ * @param detail Shown as an argument, cut to 31 bytes
+ */
+void TraceAsyncEnd(const char* name, uint64_t id, std::string_view detail = {});
+
+/**
+ * Records a slice from construction to destruction
+ */
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : m_name(name), m_start(TraceEnabled() ? TraceNow() : 0U) {}
+    ~TraceScope() {
+        if(m_start != 0U) TraceComplete(m_name, m_start);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_start;
+};
@@ -0,0 +1,226 @@
+/* Standard headers */
+#include <algorithm>
+
+#include "tracks.h"
+
+/* Helpers */
+
+/**
+ * Lowercase ASCII letters, leave everything else (including UTF-8 sequences) alone
+ * @param text Text to fold
+ * @return Folded copy
+ */
+static std::string FoldCase(std::string_view text) {
+    std::string folded(text);
+    for(char& c : folded)
+        if(c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    return folded;
+}
+
+/**
+ * Posting list key of an n-gram (n = 1 - 3): the length in the top byte, the bytes below
+ */
+static inline uint32_t GramKey(const char* p, size_t n) {
+    uint32_t key = static_cast<uint32_t>(n) << 24;
+    for(size_t i = 0; i < n; i++) key |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (8 * (2 - i));
+    return key;
+}
+
+/**
+ * Unique 1, 2 and 3-gram keys of a folded string
+ */
+static std::vector<uint32_t> Grams(std::string_view folded) {
+    std::vector<uint32_t> keys;
+    keys.reserve(folded.size() * 3);
+    for(size_t n = 1; n <= 3; n++)
+        for(size_t i = 0; i + n <= folded.size(); i++) keys.push_back(GramKey(folded.data() + i, n));
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+/* TrackIndex */
+
+void TrackIndex::insert(uint32_t id, std::string_view name) {
+    if(id >= m_live.size()) {
+        m_offsets.resize(id + 1, 0);
+        m_lengths.resize(id + 1, 0);
+        m_live.resize(id + 1, 0);
+    }
+
+    const std::string folded = FoldCase(name);
+    m_offsets[id] = static_cast<uint32_t>(m_arena.size());
+    m_lengths[id] = static_cast<uint32_t>(folded.size());
+    m_arena += folded;
+    m_live[id] = 1;
+
+    // Ids usually only grow, then appending keeps every list sorted
+    auto add = [id](std::vector<uint32_t>& ids) {
+        if(ids.empty() || ids.back() < id) ids.push_back(id);
+        else ids.insert(std::lower_bound(ids.begin(), ids.end(), id), id);
+    };
+    add(m_liveIds);
+    for(uint32_t key : Grams(folded)) add(m_postings[key]);
+    m_exact.emplace(folded, id);
+}
+
+void TrackIndex::erase(uint32_t id) {
+    if(id >= m_live.size() || !m_live[id]) return;
+
+    const std::string folded(foldedName(id));
+    for(uint32_t key : Grams(folded)) {
+        auto postings = m_postings.find(key);
+        if(postings == m_postings.end()) continue;
+        auto& ids = postings->second;
+        auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        if(it != ids.end() && *it == id) ids.erase(it);
+        if(ids.empty()) m_postings.erase(postings);
+    }
+
+    auto [first, last] = m_exact.equal_range(folded);
+    for(auto it = first; it != last; ++it) {
+        if(it->second == id) {
+            m_exact.erase(it);
+            break;
+        }
+    }
+
+    auto it = std::lower_bound(m_liveIds.begin(), m_liveIds.end(), id);
+    if(it != m_liveIds.end() && *it == id) m_liveIds.erase(it);
+
+    // the bytes stay in the arena until clear()
+    m_live[id] = 0;
+}
+
+void TrackIndex::clear() {
+    m_arena.clear();
+    m_offsets.clear();
+    m_lengths.clear();
+    m_live.clear();
+    m_liveIds.clear();
+    m_postings.clear();
+    m_exact.clear();
+}
+
+std::string_view TrackIndex::foldedName(uint32_t id) const {
+    return std::string_view(m_arena).substr(m_offsets[id], m_lengths[id]);
+}
+
+bool TrackIndex::contains(uint32_t id, std::string_view foldedQuery) const {
+    return id < m_live.size() && m_live[id] && foldedName(id).find(foldedQuery) != std::string_view::npos;
+}
+
+void TrackIndex::search(std::string_view query, std::vector<uint32_t>& out) const {
+    out.clear();
+    if(query.empty()) {
+        out = m_liveIds;
+        return;
+    }
+
+    const std::string folded = FoldCase(query);
+    if(folded.size() <= 3) {
+        // the posting list of a short query is exactly its answer
+        auto postings = m_postings.find(GramKey(folded.data(), folded.size()));
+        if(postings != m_postings.end()) out = postings->second;
+        return;
+    }
+
+    // every trigram of the query has to be present, the rarest one gives the fewest candidates
+    const std::vector<uint32_t>* rarest = nullptr;
+    for(size_t i = 0; i + 3 <= folded.size(); i++) {
+        auto postings = m_postings.find(GramKey(folded.data() + i, 3));
+        if(postings == m_postings.end()) return; // no name has this trigram
+        if(rarest == nullptr || postings->second.size() < rarest->size()) rarest = &postings->second;
+    }
+
+    for(uint32_t id : *rarest)
+        if(contains(id, folded)) out.push_back(id);
+}
+
+void TrackIndex::refine(std::string_view query, std::vector<uint32_t>& ids) const {
+    const std::string folded = FoldCase(query);
+    ids.erase(std::remove_if(ids.begin(), ids.end(), [&](uint32_t id) {
+        return !contains(id, folded);
+    }), ids.end());
+}
+
+std::optional<uint32_t> TrackIndex::find(std::string_view name) const {
+    auto it = m_exact.find(FoldCase(name));
+    if(it == m_exact.end()) return std::nullopt;
+    return it->second;
+}
+
+/* TrackTable */
+
+uint32_t TrackTable::insert(std::string name, uint64_t seconds, std::chrono::time_point<std::chrono::system_clock> syncedAt) {
+    auto id = static_cast<uint32_t>(m_records.size());
+    m_index.insert(id, name);
+    m_records.push_back(TrackRecord {std::move(name), seconds, syncedAt});
+    m_live.push_back(1);
+    m_size++;
+    m_revision++;
+    return id;
+}
+
+void TrackTable::setSeconds(uint32_t id, uint64_t seconds, std::chrono::time_point<std::chrono::system_clock> syncedAt) {
+    if(!live(id)) return;
+    m_records[id].seconds = seconds;
+    m_records[id].syncedAt = syncedAt;
+}
+
+void TrackTable::erase(uint32_t id) {
+    if(!live(id)) return;
+    m_index.erase(id);
+    m_records[id] = TrackRecord {};
+    m_live[id] = 0;
+    m_size--;
+    m_revision++;
+}
+
+void TrackTable::rename(uint32_t id, std::string name) {
+    if(!live(id)) return;
+    m_index.erase(id);
+    m_index.insert(id, name);
+    m_records[id].name = std::move(name);
+    m_revision++;
+}
+
+void TrackTable::clear() {
+    m_records.clear();
+    m_live.clear();
+    m_index.clear();
+    m_size = 0;
+    m_revision++;
+}
+
+void TrackTable::swap(TrackTable& other) {
+    std::swap(m_records, other.m_records);
+    std::swap(m_live, other.m_live);
+    std::swap(m_size, other.m_size);
+    std::swap(m_index, other.m_index);
+    m_revision = other.m_revision = std::max(m_revision, other.m_revision) + 1;
+}
+
+bool TrackTable::live(uint32_t id) const {
+    return id < m_live.size() && m_live[id];
+}
+
+const TrackRecord& TrackTable::operator[](uint32_t id) const {
+    return m_records[id];
+}
+
+size_t TrackTable::size() const {
+    return m_size;
+}
+
+uint64_t TrackTable::revision() const {
+    return m_revision;
+}
+
+std::optional<uint32_t> TrackTable::find(std::string_view name) const {
+    return m_index.find(name);
+}
+
+const TrackIndex& TrackTable::index() const {
+    return m_index;
+}
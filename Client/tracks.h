@@ -0,0 +1,173 @@
+#pragma once
+
+/* Standard headers */
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/* Track storage */
+
+/**
+ * Case-insensitive substring index over track names
+ * Names are folded to lowercase (ASCII) and every 1, 2 and 3-gram gets a posting list.
+ * Queries up to three characters are answered by a single posting list, longer ones from
+ * the rarest posting list of their trigrams, verified against the folded names.
+ */
+class TrackIndex {
+public:
+    /**
+     * Add a name
+     * Ids larger than every id inserted before are appended, others (e.g. a renamed track) are sorted in
+     * @param id Caller's id for the name, not in the index
+     * @param name Track name
+     */
+    void insert(uint32_t id, std::string_view name);
+
+    /**
+     * Remove a name added with insert()
+     * @param id Id the name was inserted with
+     */
+    void erase(uint32_t id);
+
+    /**
+     * Remove everything
+     */
+    void clear();
+
+    /**
+     * Find every name containing the query, ignoring case
+     * @param query Text to look for (empty matches everything)
+     * @param out Receives matching ids in ascending order
+     */
+    void search(std::string_view query, std::vector<uint32_t>& out) const;
+
+    /**
+     * Narrow down an earlier result, for when the query only grew
+     * @param query Text to look for
+     * @param ids Ids to check, filtered in place
+     */
+    void refine(std::string_view query, std::vector<uint32_t>& ids) const;
+
+    /**
+     * Look up a name exactly, ignoring case
+     * @param name Track name
+     * @return Id of a matching name if there is one
+     */
+    std::optional<uint32_t> find(std::string_view name) const;
+
+private:
+    std::string m_arena;                 // lowercase names back to back
+    std::vector<uint32_t> m_offsets;     // by id, into m_arena
+    std::vector<uint32_t> m_lengths;     // by id
+    std::vector<uint8_t> m_live;         // by id
+    std::vector<uint32_t> m_liveIds;     // ascending
+    std::unordered_map<uint32_t, std::vector<uint32_t>> m_postings; // n-gram -> ascending ids
+    std::unordered_multimap<std::string, uint32_t> m_exact;         // folded name -> id
+
+    std::string_view foldedName(uint32_t id) const;
+    bool contains(uint32_t id, std::string_view foldedQuery) const;
+};
+
+/**
+ * A track as known to the client
+ */
+struct TrackRecord {
+    std::string name;
+    uint64_t seconds{};                                              // as last reported by the server
+    std::chrono::time_point<std::chrono::system_clock> syncedAt{};  // when seconds was reported
+};
+
+/**
+ * Tracks of the signed in account, in server order, plus a search index
+ * Ids are slots that stay valid until clear(), erased slots are never reused.
+ */
+class TrackTable {
+public:
+    /**
+     * Append a track
+     * @param name Track name
+     * @param seconds Seconds the server has saved for the track
+     * @param syncedAt When the server reported them
+     * @return Id of the new track
+     */
+    uint32_t insert(std::string name, uint64_t seconds = 0, std::chrono::time_point<std::chrono::system_clock> syncedAt = {});
+
+    /**
+     * Record a newer seconds value reported by the server
+     * @param id Track id
+     * @param seconds Seconds the server has saved for the track
+     * @param syncedAt When the server reported them
+     */
+    void setSeconds(uint32_t id, uint64_t seconds, std::chrono::time_point<std::chrono::system_clock> syncedAt);
+
+    /**
+     * Remove a track
+     * @param id Track id
+     */
+    void erase(uint32_t id);
+
+    /**
+     * Rename a track, keeping its id and position
+     * @param id Track id
+     * @param name New track name
+     */
+    void rename(uint32_t id, std::string name);
+
+    /**
+     * Remove all tracks and start ids over
+     */
+    void clear();
+
+    /**
+     * Exchange contents with another table in O(1)
+     * Both revisions move past either old one, so views of either table refresh
+     * @param other Table to exchange with
+     */
+    void swap(TrackTable& other);
+
+    /**
+     * @param id Track id
+     * @return Boolean for whether the id refers to a track that was not erased
+     */
+    bool live(uint32_t id) const;
+
+    /**
+     * @param id Id of a live track
+     * @return The track
+     */
+    const TrackRecord& operator[](uint32_t id) const;
+
+    /**
+     * @return Number of live tracks
+     */
+    size_t size() const;
+
+    /**
+     * Changes on every insert(), erase(), rename() and clear(), so views know when to refresh
+     * @return Revision counter
+     */
+    uint64_t revision() const;
+
+    /**
+     * Look up a track by name, ignoring case (as the server does)
+     * @param name Track name
+     * @return Id of the track if it exists
+     */
+    std::optional<uint32_t> find(std::string_view name) const;
+
+    /**
+     * The search index over track names
+     */
+    const TrackIndex& index() const;
+
+private:
+    std::vector<TrackRecord> m_records;
+    std::vector<uint8_t> m_live;
+    size_t m_size = 0;
+    uint64_t m_revision = 0;
+    TrackIndex m_index;
+};
@@ -0,0 +1,93 @@
+/* Response compression benchmark
+ * Serves synthetic /api/account payloads through the compression middleware and fetches them
+ * with every encoding, reporting bytes on the wire and latency.
+ *
+ *   node bench/compression.js [--mbps 20] [--rtt 40] [--runs 20]
+ *
+ * Loopback latency is measured. The link columns add the time the wire bytes take at --mbps
+ * plus one --rtt, which is what a VPN round trip adds on top of the loopback numbers.
+ */
+
+/* Imports */
+const http = require('http');
+const zlib = require('zlib');
+const { compression, encoders } = require('../compression');
+
+/* Configuration */
+const args = process.argv.slice(2);
+const option = (name, fallback) => {
+    const index = args.indexOf(`--${name}`);
+    return index >= 0 && index + 1 < args.length ? Number(args[index + 1]) : fallback;
+};
+const mbps = option('mbps', 20);
+const rtt = option('rtt', 40);
+const runs = option('runs', 20);
+const trackCounts = [10, 1000, 10000, 100000];
+
+// Same shape as the /api/account response
+function accountPayload(tracks) {
+    const details = { behavior: 'ACCOUNT', tracks: [], userId: 1, username: 'benchmark' };
+    for (let i = 0; i < tracks; i++) details.tracks.push({ 'track': `Project ${i % 97} - task ${i}`, 'seconds': (i * 7919) % 360000 });
+    return JSON.stringify(details);
+}
+
+const decoders = {
+    identity: body => body,
+    gzip: body => zlib.gunzipSync(body),
+    deflate: body => zlib.inflateSync(body),
+    zstd: body => zlib.zstdDecompressSync(body)
+};
+
+// One request, resolves with { wire bytes, milliseconds until the decoded body is ready }
+function fetch(agent, port, path, encoding) {
+    return new Promise((resolve, reject) => {
+        const started = process.hrtime.bigint();
+        const req = http.get({ agent, port, path, headers: encoding == 'identity' ? {} : { 'Accept-Encoding': encoding } }, res => {
+            const chunks = [];
+            res.on('data', chunk => chunks.push(chunk));
+            res.on('end', () => {
+                const wire = Buffer.concat(chunks);
+                const used = res.headers['content-encoding'] || 'identity';
+                JSON.parse(decoders[used](wire).toString('utf8'));
+                resolve({ bytes: wire.length, ms: Number(process.hrtime.bigint() - started) / 1e6 });
+            });
+        });
+        req.on('error', reject);
+    });
+}
+
+const median = values => values.slice().sort((a, b) => a - b)[Math.floor(values.length / 2)];
+
+async function main() {
+    const payloads = Object.fromEntries(trackCounts.map(count => [count, accountPayload(count)]));
+    const compress = compression();
+
+    const server = http.createServer((req, res) => compress(req, res, () => {
+        res.setHeader('Content-Type', 'application/json');
+        res.end(payloads[Number(req.url.substring(1))]);
+    }));
+    const agent = new http.Agent({ keepAlive: true });
+    await new Promise(resolve => server.listen(0, '127.0.0.1', resolve));
+    const port = server.address().port;
+
+    console.log(`link model: ${mbps} Mbit/s, ${rtt} ms RTT, median of ${runs} runs`);
+    console.log(['tracks', 'encoding', 'wire bytes', 'ratio', 'loopback ms', 'link ms'].map(name => name.padStart(12)).join(''));
+
+    for (const count of trackCounts) {
+        for (const encoding of ['identity', ...encoders.map(([name]) => name)]) {
+            const samples = [];
+            for (let i = 0; i < runs; i++) samples.push(await fetch(agent, port, `/${count}`, encoding));
+
+            const bytes = samples[0].bytes;
+            const loopback = median(samples.map(sample => sample.ms));
+            const link = loopback + rtt + bytes * 8 / (mbps * 1000);
+            console.log([count, encoding, bytes, (payloads[count].length / bytes).toFixed(1) + 'x', loopback.toFixed(2), link.toFixed(1)]
+                .map(value => String(value).padStart(12)).join(''));
+        }
+    }
+
+    agent.destroy();
+    server.close();
+}
+
+main();
@@ -0,0 +1,132 @@
+/* Push channel load test
+ * Holds many idle /api/stream connections open against a running server, then saves time on a
+ * track and measures how long the change takes to reach every client.
+ *
+ *   node bench/stream_load.js --uid 1 --track Work [--clients 5000] [--host 127.0.0.1] [--port 5540] [--rounds 5]
+ *
+ * Each client needs a file descriptor on both ends, raise `ulimit -n` for the client and the server
+ * first. Pass --pid <server pid> to report the server's resident memory (Linux).
+ */
+
+/* Imports */
+const http = require('http');
+const { readFileSync } = require('fs');
+
+/* Configuration */
+const args = process.argv.slice(2);
+const option = (name, fallback) => {
+    const index = args.indexOf(`--${name}`);
+    return index >= 0 && index + 1 < args.length ? args[index + 1] : fallback;
+};
+const host = option('host', '127.0.0.1');
+const port = Number(option('port', 5540));
+const uid = option('uid', null);
+const track = option('track', null);
+const clients = Number(option('clients', 5000));
+const rounds = Number(option('rounds', 5));
+const pid = option('pid', null);
+
+if (!uid || !track) {
+    console.error('usage: node bench/stream_load.js --uid <user id> --track <existing track> [--clients N]');
+    process.exit(1);
+}
+
+// One agent socket per stream, no pooling limits
+const agent = new http.Agent({ keepAlive: true, maxSockets: Infinity });
+
+// Server resident memory in MiB, if we know its pid
+function serverMemory() {
+    if (!pid) return null;
+    try {
+        const status = readFileSync(`/proc/${pid}/status`, 'utf8');
+        return Number(/VmRSS:\s+(\d+)/.exec(status)[1]) / 1024;
+    } catch {
+        return null;
+    }
+}
+
+// Open one stream, resolves once the server accepted it. onEvent gets every changes event
+function openStream(since, onEvent) {
+    return new Promise((resolve, reject) => {
+        const req = http.get({ agent, host, port, path: `/api/stream?uid=${uid}&since=${since}` }, res => {
+            if (res.statusCode != 200) return reject(new Error(`HTTP ${res.statusCode}`));
+            let buffer = '';
+            res.setEncoding('utf8');
+            res.on('data', chunk => {
+                buffer += chunk;
+                for (let end; (end = buffer.indexOf('\n\n')) >= 0;) {
+                    const event = buffer.substring(0, end);
+                    buffer = buffer.substring(end + 2);
+                    const data = event.split('\n').filter(line => line.startsWith('data:')).map(line => line.substring(5).trim()).join('\n');
+                    if (data) onEvent(JSON.parse(data));
+                }
+            });
+            resolve(req);
+        });
+        req.on('error', reject);
+    });
+}
+
+// POST a form to the API
+function post(path, form) {
+    return new Promise((resolve, reject) => {
+        const body = new URLSearchParams(form).toString();
+        const req = http.request({ host, port, path, method: 'POST', headers: { 'Content-Type': 'application/x-www-form-urlencoded', 'Content-Length': Buffer.byteLength(body) } }, res => {
+            let text = '';
+            res.on('data', chunk => text += chunk);
+            res.on('end', () => resolve(JSON.parse(text)));
+        });
+        req.on('error', reject);
+        req.end(body);
+    });
+}
+
+const percentile = (values, p) => values.slice().sort((a, b) => a - b)[Math.min(values.length - 1, Math.floor(values.length * p))];
+
+async function main() {
+    // Start everyone at the current revision, so only new changes arrive
+    const account = await post('/api/account', { uid });
+    if (account.error) throw new Error(account.error);
+    const since = account.seq;
+
+    const memoryBefore = serverMemory();
+    let waiting = null;
+    const connected = [];
+    const started = Date.now();
+    for (let i = 0; i < clients; i++) {
+        connected.push(await openStream(since, () => waiting && waiting(i)));
+        if ((i + 1) % 1000 == 0) console.log(`${i + 1} clients connected`);
+    }
+    console.log(`${clients} clients connected in ${((Date.now() - started) / 1000).toFixed(1)} s`);
+    const memoryAfter = serverMemory();
+    if (memoryBefore != null) console.log(`server RSS ${memoryBefore.toFixed(0)} MiB -> ${memoryAfter.toFixed(0)} MiB (${((memoryAfter - memoryBefore) * 1024 / clients).toFixed(1)} KiB per client)`);
+
+    // Let the connections sit idle for a heartbeat or two
+    await new Promise(resolve => setTimeout(resolve, 1000));
+
+    for (let round = 0; round < rounds; round++) {
+        const latencies = new Array(clients).fill(null);
+        let remaining = clients;
+        const sent = process.hrtime.bigint();
+        const delivered = new Promise(resolve => {
+            waiting = i => {
+                if (latencies[i] != null) return;
+                latencies[i] = Number(process.hrtime.bigint() - sent) / 1e6;
+                if (--remaining == 0) resolve();
+            };
+        });
+
+        await post('/api/update', { uid, track, seconds: 1 });
+        await delivered;
+        console.log(`round ${round + 1}: fan-out to ${clients} clients p50 ${percentile(latencies, 0.5).toFixed(1)} ms, ` +
+                    `p99 ${percentile(latencies, 0.99).toFixed(1)} ms, max ${Math.max(...latencies).toFixed(1)} ms`);
+    }
+
+    for (const req of connected) req.destroy();
+    agent.destroy();
+}
+
+main().catch(error => {
+    console.error(error);
+    process.exit(1);
+});
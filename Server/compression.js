@@ -0,0 +1,74 @@
+/* Imports */
+const zlib = require('zlib');
+
+/* Response compression */
+
+// Bodies below this many bytes are sent as they are, compressing them costs more than it saves
+const defaultThreshold = 1024;
+
+// In order of preference. zstd needs Node 22.15 / 23.8 or newer
+const encoders = [
+    ...(typeof zlib.zstdCompress == 'function' ? [['zstd', (body, done) => zlib.zstdCompress(body, done)]] : []),
+    ['gzip', (body, done) => zlib.gzip(body, { level: 6 }, done)],
+    ['deflate', (body, done) => zlib.deflate(body, { level: 6 }, done)]
+];
+
+// Pick the encoding for an Accept-Encoding header, null for identity
+function negotiateEncoding(header) {
+    if (!header) return null;
+
+    // "gzip;q=0.8, zstd, *;q=0" -> { gzip: 0.8, zstd: 1, '*': 0 }
+    const weights = {};
+    for (const part of header.split(',')) {
+        const [name, ...params] = part.trim().toLowerCase().split(';');
+        if (!name) continue;
+        const q = params.map(param => param.trim()).find(param => param.startsWith('q='));
+        weights[name] = q ? Number(q.substring(2)) || 0 : 1;
+    }
+
+    let best = null, bestWeight = 0;
+    for (const [name] of encoders) {
+        const weight = name in weights ? weights[name] : ('*' in weights ? weights['*'] : 0);
+        if (weight > bestWeight) {
+            best = name;
+            bestWeight = weight;
+        }
+    }
+    return best;
+}
+
+// Middleware compressing bodies passed to res.end() (every API route answers that way)
+function compression(options = {}) {
+    const threshold = options.threshold ?? defaultThreshold;
+
+    return (req, res, next) => {
+        const end = res.end;
+
+        res.end = function (chunk, encoding, callback) {
+            // Streams (sendFile), empty bodies and already encoded ones pass through
+            if (chunk == null || typeof chunk == 'function' || res.headersSent || res.getHeader('Content-Encoding')) return end.apply(this, arguments);
+
+            const body = Buffer.isBuffer(chunk) ? chunk : Buffer.from(chunk, typeof encoding == 'string' ? encoding : 'utf8');
+            const done = typeof encoding == 'function' ? encoding : callback;
+
+            const vary = res.getHeader('Vary');
+            if (!vary) res.setHeader('Vary', 'Accept-Encoding');
+            else if (!String(vary).toLowerCase().includes('accept-encoding')) res.setHeader('Vary', `${vary}, Accept-Encoding`);
+
+            const method = body.length >= threshold ? negotiateEncoding(req.headers['accept-encoding']) : null;
+            if (!method) return end.call(this, body, done);
+
+            encoders.find(([name]) => name == method)[1](body, (error, compressed) => {
+                if (error) return end.call(this, body, done);
+                res.setHeader('Content-Encoding', method);
+                res.setHeader('Content-Length', compressed.length);
+                end.call(this, compressed, done);
+            });
+            return this;
+        };
+
+        next();
+    };
+}
+
+module.exports = { compression, negotiateEncoding, encoders };
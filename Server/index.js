@@ -9,6 +9,7 @@ const express = require('express');
 const sqlite = require('sqlite3').verbose();
 // const jwt = require('jose');
 const { assert } = require('console');
+const { compression } = require('./compression');
 
 /* Global variables */
 const app = express();
@@ -18,6 +19,9 @@ const packageConfig = JSON.parse(readFileSync(path.join(__dirname, 'package.json
 // Enable HTTP POST JSON body
 app.use(express.urlencoded({ extended: true }));
 
+// Compress larger responses (e.g. /api/account of big accounts) for clients that accept it
+app.use(compression());
+
 // Get data from the database
 async function dbGet(query, params) {
     assert(typeof query == 'string' && typeof params == 'object' && params instanceof Array, 'dbGet args malformed.');
@@ -46,10 +50,73 @@ function dbRun(queries) {
     });
 }
 
+// Run a single command, resolves with the number of changed rows
+function dbChange(query, params) {
+    assert(typeof query == 'string' && typeof params == 'object' && params instanceof Array, 'dbChange args malformed.');
+
+    return new Promise((res, rej) => {
+        db.run(query, params, function (error) {
+            if (error) rej(error);
+            else res(this.changes);
+        });
+    });
+}
+
+// Writes and transactions run one at a time, every request shares the connection so a write
+// issued while a transaction is open would land inside it and be undone by its ROLLBACK
+let transactionTail = Promise.resolve();
+
+// Run a single write once no transaction is open, resolves with the number of changed rows
+function dbWrite(query, params) {
+    const result = transactionTail.then(() => dbChange(query, params));
+    transactionTail = result.catch(() => {});
+    return result;
+}
+
+// Run work inside BEGIN IMMEDIATE/COMMIT, rolled back if it throws. Resolves with work's result
+function dbTransaction(work) {
+    const result = transactionTail.then(async () => {
+        await dbChange("BEGIN IMMEDIATE", []);
+        try {
+            const value = await work();
+            await dbChange("COMMIT", []);
+            return value;
+        } catch (error) {
+            await dbChange("ROLLBACK", []).catch(() => {});
+            throw error;
+        }
+    });
+    transactionTail = result.catch(() => {});
+    return result;
+}
+
 // Set up tables
 dbRun([
     "CREATE TABLE IF NOT EXISTS accounts (uid INTEGER PRIMARY KEY AUTOINCREMENT, user TEXT, pass TEXT)", [],
-    "CREATE TABLE IF NOT EXISTS tracks (uid INTEGER, track TEXT, seconds INTEGER)", []
+    "CREATE TABLE IF NOT EXISTS tracks (uid INTEGER, track TEXT, seconds INTEGER)", [],
+    // Intervals uploaded from client journals, the client id makes replays harmless
+    "CREATE TABLE IF NOT EXISTS sessions (uid INTEGER, id TEXT, track TEXT, started INTEGER, ended INTEGER, UNIQUE(uid, id))", [],
+    // Per-user change feed, seq is the account revision the change produced
+    "CREATE TABLE IF NOT EXISTS changes (uid INTEGER, seq INTEGER, kind TEXT, track TEXT, name TEXT, seconds INTEGER, PRIMARY KEY (uid, seq)) WITHOUT ROWID", []
+]);
+
+// Account revision, bumped whenever the /api/account payload changes (fails harmlessly once the column exists)
+db.serialize(() => db.run("ALTER TABLE accounts ADD COLUMN rev INTEGER NOT NULL DEFAULT 0", [], () => {}));
+
+// Changes older than this many revisions are dropped, clients that far behind reload /api/account
+const changeHistory = 10000;
+
+// Every change to tracks bumps the revision and logs the change in the same statement,
+// so the feed never has gaps or a revision without its change
+const logChange = (uid, kind, track, name, seconds) =>
+    `UPDATE accounts SET rev=rev+1 WHERE uid=${uid}; ` +
+    `INSERT INTO changes (uid, seq, kind, track, name, seconds) SELECT uid, rev, '${kind}', ${track}, ${name}, ${seconds} FROM accounts WHERE uid=${uid};`;
+dbRun([
+    `CREATE TRIGGER IF NOT EXISTS tracks_insert AFTER INSERT ON tracks BEGIN ${logChange('NEW.uid', 'insert', 'NEW.track', 'NULL', 'NEW.seconds')} END`, [],
+    `CREATE TRIGGER IF NOT EXISTS tracks_delete AFTER DELETE ON tracks BEGIN ${logChange('OLD.uid', 'delete', 'OLD.track', 'NULL', 'NULL')} END`, [],
+    `CREATE TRIGGER IF NOT EXISTS tracks_rename AFTER UPDATE ON tracks WHEN OLD.track != NEW.track BEGIN ${logChange('NEW.uid', 'rename', 'OLD.track', 'NEW.track', 'NEW.seconds')} END`, [],
+    `CREATE TRIGGER IF NOT EXISTS tracks_seconds AFTER UPDATE ON tracks WHEN OLD.track = NEW.track BEGIN ${logChange('NEW.uid', 'seconds', 'NEW.track', 'NULL', 'NEW.seconds')} END`, [],
+    `CREATE TRIGGER IF NOT EXISTS changes_prune AFTER INSERT ON changes BEGIN DELETE FROM changes WHERE uid=NEW.uid AND seq <= NEW.seq - ${changeHistory}; END`, []
 ]);
 
 app.get('/api', (req, res) => {
@@ -89,11 +156,12 @@ app.post('/api/login', async (req, res) => {
     });
 });
 
-app.post('/api/account', async(req, res) => {
+// Send the account details, tagged with the account revision so unchanged ones cost a 304
+async function sendAccount(req, res, uid) {
     res.setHeader('Content-Type', 'application/json');
 
     // Has all the fields
-    if(!req.body || !req.body.uid) return res.end(JSON.stringify({'error': 'Did not supply a user id.'}));
+    if(!uid) return res.end(JSON.stringify({'error': 'Did not supply a user id.'}));
 
     var details = {
         behavior: 'ACCOUNT',
@@ -101,9 +169,22 @@ app.post('/api/account', async(req, res) => {
     };
     
     // Get the account details
-    return await dbGet("SELECT * FROM accounts WHERE uid=?", [req.body.uid]).then((rows) => {
+    return await dbGet("SELECT * FROM accounts WHERE uid=?", [uid]).then((rows) => {
+        // Weak, the body may be sent compressed
+        const etag = `W/"${rows[0].uid}-${rows[0].rev}"`;
+        res.setHeader('ETag', etag);
+        res.setHeader('Cache-Control', 'no-cache');
+
+        const ifNoneMatch = req.headers['if-none-match'];
+        if (ifNoneMatch && ifNoneMatch.split(',').some(tag => tag.trim() == etag || tag.trim() == '*')) {
+            // Client copy is current
+            res.statusCode = 304;
+            return res.end();
+        }
+
         details.userId = rows[0].uid;
         details.username = rows[0].user;
+        details.seq = rows[0].rev; // continue with /api/changes?since= from here
         // Get the track details
         dbGet("SELECT * FROM tracks WHERE uid=?", [rows[0].uid]).then(rows => {
             for(let x in rows) {
@@ -115,8 +196,119 @@ app.post('/api/account', async(req, res) => {
         // Account not found
         res.end(JSON.stringify({'error': 'User with ID not found.'}));
     });
+}
+
+app.get('/api/account', (req, res) => sendAccount(req, res, req.query.uid));
+app.post('/api/account', (req, res) => sendAccount(req, res, req.body && req.body.uid));
+
+// /api/changes payload for a client at revision since, changes holds (at least) those after it
+function changesPayload(uid, rev, since, changes) {
+    changes = changes.filter(change => change.seq > since && change.seq <= rev);
+
+    // Changes the client needs were pruned (or it is ahead of a reset database), it has to reload
+    const oldest = changes.length ? changes[0].seq : rev + 1;
+    if (since > rev || (since < rev && oldest != since + 1)) return { behavior: 'CHANGES', seq: rev, reset: true };
+
+    return {
+        behavior: 'CHANGES',
+        seq: rev,
+        etag: `W/"${uid}-${rev}"`,
+        changes: changes.map(change => ({ 'seq': change.seq, 'kind': change.kind, 'track': change.track, 'name': change.name ?? undefined, 'seconds': change.seconds ?? undefined }))
+    };
+}
+
+// Send the track changes after a revision, so syncing costs O(changes) instead of O(tracks)
+async function sendChanges(req, res, uid, since) {
+    res.setHeader('Content-Type', 'application/json');
+
+    // Has all the fields
+    if (!uid || since === undefined || isNaN(Number(since))) return res.end(JSON.stringify({ 'error': 'Incomplete request.' }));
+    since = Number(since);
+
+    return await dbGet("SELECT * FROM accounts WHERE uid=?", [uid]).then(async rows => {
+        // Same version tag as /api/account, it describes the state after applying the changes
+        const rev = rows[0].rev;
+        res.setHeader('ETag', `W/"${rows[0].uid}-${rev}"`);
+
+        const changes = await dbGet("SELECT * FROM changes WHERE uid=? AND seq>? AND seq<=? ORDER BY seq", [uid, since, rev]).catch(() => []);
+        res.end(JSON.stringify(changesPayload(rows[0].uid, rev, since, changes)));
+    }, err => {
+        // Account not found
+        res.end(JSON.stringify({'error': 'User with ID not found.'}));
+    });
+}
+
+app.get('/api/changes', (req, res) => sendChanges(req, res, req.query.uid, req.query.since));
+app.post('/api/changes', (req, res) => sendChanges(req, res, req.body && req.body.uid, req.body && req.body.since));
+
+/* Push channel */
+
+// Open change streams by user id, each { res, seq } with seq the revision the client has
+const streams = new Map();
+
+// Clients drop a stream that stays silent this long, so idle ones get a comment now and then
+const streamHeartbeat = 25 * 1000;
+
+// Publishes still running by user id, each user's run one after another
+const publishing = new Map();
+
+// Send every open stream of a user the changes it has not seen yet. Serialized per user: a slower
+// publish finishing after a newer one would see the stream ahead of its revision and reset it
+function publishChanges(uid, targets) {
+    uid = Number(uid);
+    const run = (publishing.get(uid) || Promise.resolve()).then(() => sendStreamChanges(uid, targets)).catch(error => console.error(error));
+    publishing.set(uid, run);
+    run.then(() => { if (publishing.get(uid) === run) publishing.delete(uid); });
+    return run;
+}
+
+async function sendStreamChanges(uid, targets = streams.get(uid)) {
+    if (!targets || !targets.size) return;
+
+    const rows = await dbGet("SELECT * FROM accounts WHERE uid=?", [uid]).catch(() => null);
+    if (!rows) return;
+    const rev = rows[0].rev;
+
+    const since = Math.min(...[...targets].map(stream => stream.seq));
+    const changes = since < rev ? await dbGet("SELECT * FROM changes WHERE uid=? AND seq>? AND seq<=? ORDER BY seq", [uid, since, rev]).catch(() => []) : [];
+
+    for (const stream of targets) {
+        if (stream.seq == rev) continue;
+        const payload = changesPayload(rows[0].uid, rev, stream.seq, changes);
+        stream.seq = rev;
+        stream.res.write(`id: ${rev}\nevent: changes\ndata: ${JSON.stringify(payload)}\n\n`);
+    }
+}
+
+// Server-Sent Events carrying /api/changes payloads as they happen, starting after revision since
+app.get('/api/stream', async (req, res) => {
+    const uid = Number(req.query.uid), since = Number(req.query.since);
+    if (!uid || isNaN(since)) {
+        res.setHeader('Content-Type', 'application/json');
+        return res.end(JSON.stringify({ 'error': 'Incomplete request.' }));
+    }
+
+    res.writeHead(200, { 'Content-Type': 'text/event-stream', 'Cache-Control': 'no-cache', 'Connection': 'keep-alive' });
+    res.write(': connected\n\n');
+
+    const stream = { res, seq: since };
+    if (!streams.has(uid)) streams.set(uid, new Set());
+    streams.get(uid).add(stream);
+    req.on('close', () => {
+        const userStreams = streams.get(uid);
+        userStreams.delete(stream);
+        if (!userStreams.size) streams.delete(uid);
+    });
+
+    // Catch up on whatever happened since the client's copy
+    return await publishChanges(uid, new Set([stream]));
 });
 
+setInterval(() => {
+    for (const userStreams of streams.values())
+        for (const stream of userStreams) stream.res.write(': heartbeat\n\n');
+}, streamHeartbeat).unref();
+
 app.post('/api/register', async (req, res) => {
     res.setHeader('Content-Type', 'application/json');
 
@@ -133,10 +325,12 @@ app.post('/api/register', async (req, res) => {
         res.end(JSON.stringify({ 'error': 'Username conflict.' }));
     }, async error => {
         // Create a new user
-        dbRun([
-            "INSERT INTO accounts (user, pass) VALUES (?, ?)", [req.body.username, req.body.password],
-        ]);
-        res.end(JSON.stringify({ 'message': 'Try logging in now! :)' }));
+        await dbWrite("INSERT INTO accounts (user, pass) VALUES (?, ?)", [req.body.username, req.body.password]).then(() => {
+            res.end(JSON.stringify({ 'message': 'Try logging in now! :)' }));
+        }, error => {
+            console.error(error);
+            res.end(JSON.stringify({ 'error': 'Failed to register.' }));
+        });
     });
 });
 
@@ -155,11 +349,13 @@ app.post('/api/new', async (req, res) => {
         console.table(rows);
         res.end(JSON.stringify({ 'error': 'Track name conflict.' }));
     }, async error => {
-        // Create a new user
-        dbRun([
-            "INSERT INTO tracks (uid, track, seconds) VALUES (?, ?, ?)", [req.body.uid, req.body.track, 0],
-        ]);
+        // Create a new track, streams only see it once it is written
+        await dbWrite("INSERT INTO tracks (uid, track, seconds) VALUES (?, ?, ?)", [req.body.uid, req.body.track, 0]);
         res.end(JSON.stringify({ 'message': 'Added track!' }));
+        publishChanges(req.body.uid);
+    }).catch(error => {
+        console.error(error);
+        res.end(JSON.stringify({ 'error': 'Could not add track.' }));
     });
 });
 
@@ -172,17 +368,98 @@ app.post('/api/update', async (req, res) => {
     console.table(req.body);
 
     // Get track from tracks
-    return await dbGet("SELECT * FROM tracks WHERE track=? COLLATE NOCASE AND uid=?", [req.body.track, req.body.uid]).then(rows => {
+    return await dbGet("SELECT * FROM tracks WHERE track=? COLLATE NOCASE AND uid=?", [req.body.track, req.body.uid]).then(async rows => {
         // Track found
         var seconds = Number(req.body.seconds) + Number(rows[0].seconds);
 
         // Update track number
-        dbRun(['UPDATE tracks SET seconds=? WHERE track=? COLLATE NOCASE AND uid=?', [seconds, req.body.track, req.body.uid]]);
+        await dbWrite('UPDATE tracks SET seconds=? WHERE track=? COLLATE NOCASE AND uid=?', [seconds, req.body.track, req.body.uid]);
 
         res.end(JSON.stringify({ behavior: 'SAVEACK', message: 'Saved!' }));
+        publishChanges(req.body.uid);
     }, error => {
         // Track not found
         res.end(JSON.stringify({ 'error': 'Track not found.' }));
+    }).catch(error => {
+        console.error(error);
+        res.end(JSON.stringify({ 'error': 'Could not save.' }));
+    });
+});
+
+app.post('/api/sessions', async (req, res) => {
+    res.setHeader('Content-Type', 'application/json');
+
+    // Has all the fields, one id/track/start/end per interval (repeated keys arrive as arrays)
+    if (!req.body || !req.body.uid || !req.body.id || !req.body.track || !req.body.start || !req.body.end) return res.end(JSON.stringify({ 'error': 'Incomplete request.' }));
+
+    const ids = [].concat(req.body.id), tracks = [].concat(req.body.track);
+    const starts = [].concat(req.body.start), ends = [].concat(req.body.end);
+    if (tracks.length != ids.length || starts.length != ids.length || ends.length != ids.length) return res.end(JSON.stringify({ 'error': 'Malformed sessions.' }));
+
+    try {
+        const touched = new Set(), acked = [], failed = [];
+        await dbTransaction(async () => {
+            for (let i = 0; i < ids.length; i++) {
+                const seconds = Math.max(0, Number(ends[i]) - Number(starts[i]));
+
+                // Only the first upload of an interval counts, replays are acknowledged again
+                const stored = await dbGet("SELECT id FROM sessions WHERE uid=? AND id=?", [req.body.uid, ids[i]]).catch(() => null);
+                if (stored) {
+                    acked.push(ids[i]);
+                    continue;
+                }
+
+                // Track is gone (or renamed meanwhile), the client keeps the interval
+                const updated = await dbChange("UPDATE tracks SET seconds=seconds+? WHERE track=? COLLATE NOCASE AND uid=?", [seconds, tracks[i], req.body.uid]);
+                if (!updated) {
+                    failed.push(ids[i]);
+                    continue;
+                }
+
+                await dbChange("INSERT INTO sessions (uid, id, track, started, ended) VALUES (?, ?, ?, ?, ?)", [req.body.uid, ids[i], tracks[i], starts[i], ends[i]]);
+                acked.push(ids[i]);
+                touched.add(tracks[i].toLowerCase());
+            }
+        });
+
+        // Report the new totals of the affected tracks
+        const rows = await dbGet("SELECT * FROM tracks WHERE uid=?", [req.body.uid]).catch(() => []);
+        const totals = rows.filter(row => touched.has(row.track.toLowerCase())).map(row => ({ 'track': row.track, 'seconds': row.seconds }));
+
+        const message = failed.length ? `${failed.length} session(s) not saved, track not found.` : 'Saved!';
+        res.end(JSON.stringify({ behavior: 'SESSIONACK', message: message, 'ids': acked, 'failed': failed, 'tracks': totals }));
+        publishChanges(req.body.uid);
+    } catch (error) {
+        console.error(error);
+        res.end(JSON.stringify({ 'error': 'Could not save sessions.' }));
+    }
+});
+
+app.post('/api/rename', async (req, res) => {
+    res.setHeader('Content-Type', 'application/json');
+
+    // Has all the fields
+    if (!req.body || !req.body.uid || !req.body.track || !req.body.name) return res.end(JSON.stringify({ 'error': 'Incomplete request.' }));
+
+    console.table(req.body);
+
+    // Names are unique ignoring case, only the track itself may hold the new name (a case change)
+    const taken = await dbGet("SELECT * FROM tracks WHERE track=? COLLATE NOCASE AND uid=?", [req.body.name, req.body.uid]).catch(() => []);
+    if (taken.length && taken[0].track.toLowerCase() != String(req.body.track).toLowerCase()) return res.end(JSON.stringify({ 'error': 'Track name conflict.' }));
+
+    // Get track from tracks
+    return await dbGet("SELECT * FROM tracks WHERE track=? COLLATE NOCASE AND uid=?", [req.body.track, req.body.uid]).then(async rows => {
+        // Track found
+        await dbWrite('UPDATE tracks SET track=? WHERE track=? COLLATE NOCASE AND uid=?', [req.body.name, req.body.track, req.body.uid]);
+
+        res.end(JSON.stringify({ message: 'Track renamed.' }));
+        publishChanges(req.body.uid);
+    }, error => {
+        // Track not found
+        res.end(JSON.stringify({ 'error': 'Track not found.' }));
+    }).catch(error => {
+        console.error(error);
+        res.end(JSON.stringify({ 'error': 'Could not rename track.' }));
     });
 });
 
@@ -195,16 +472,20 @@ app.post('/api/delete', async (req, res) => {
     console.table(req.body);
 
     // Get track from tracks
-    return await dbGet("SELECT * FROM tracks WHERE track=? COLLATE NOCASE AND uid=?", [req.body.track, req.body.uid]).then(rows => {
+    return await dbGet("SELECT * FROM tracks WHERE track=? COLLATE NOCASE AND uid=?", [req.body.track, req.body.uid]).then(async rows => {
         // Track found
 
         // Delete track
-        dbRun(['DELETE FROM tracks WHERE track=? COLLATE NOCASE AND uid=?', [req.body.track, req.body.uid]]);
+        await dbWrite('DELETE FROM tracks WHERE track=? COLLATE NOCASE AND uid=?', [req.body.track, req.body.uid]);
 
         res.end(JSON.stringify({ message: 'Track deleted.' }));
+        publishChanges(req.body.uid);
     }, error => {
         // Track not found
         res.end(JSON.stringify({ 'error': 'Track not found.' }));
+    }).catch(error => {
+        console.error(error);
+        res.end(JSON.stringify({ 'error': 'Could not delete track.' }));
     });
 });
 
@@ -225,6 +506,10 @@ var server = app.listen(port, () => {
     console.log(`Time Tracker app listening on port ${port}`);
 });
 
+// Clients warm up a connection before the first request, keep idle ones around long enough to be used
+server.keepAliveTimeout = 60 * 1000;
+server.headersTimeout = 61 * 1000;
+
 process.on('SIGINT', () => {
     server.close();
     db.close();